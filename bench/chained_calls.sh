@@ -0,0 +1,74 @@
+#!/bin/bash
+#
+# Regression benchmark of the typing of the expressions: it checks the
+# semantic analysis of long chains of calls a.f().f()...f() is linear.
+#
+# Usage: bench/chained_calls.sh [path to vsopc]
+#
+# Each chain length is checked with -c (parsing and semantic analysis
+# only). The script fails if multiplying the length by 4 multiplies the
+# time by more than 8, which a quadratic typing does on long chains.
+
+VSOPC=${1:-$(dirname "$0")/../src/vsopc}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ ! -x "$VSOPC" ]; then
+    echo "chained_calls: vsopc not found at $VSOPC" >&2
+    exit 1
+fi
+
+# Writes a program whose main holds a chain of n calls
+generate(){
+    local n=$1 file=$2
+
+    {
+        echo "class A {"
+        echo "    f() : A { self }"
+        echo "}"
+        echo "class Main {"
+        echo "    main() : int32 {"
+        printf "        (new A)"
+        for ((i = 0; i < n; i++)); do printf ".f()"; done
+        echo ";"
+        echo "        0"
+        echo "    }"
+        echo "}"
+    } > "$file"
+}
+
+# Best of 3 runs of vsopc -c, in milliseconds
+measure(){
+    local file=$1 best=""
+
+    for run in 1 2 3; do
+        local start=$(date +%s%N)
+        "$VSOPC" -c "$file" > /dev/null || exit 1
+        local time=$(( ($(date +%s%N) - start) / 1000000 ))
+
+        if [ -z "$best" ] || [ "$time" -lt "$best" ]; then
+            best=$time
+        fi
+    done
+
+    echo "$best"
+}
+
+status=0
+previous=""
+
+for n in 2000 8000 32000; do
+    generate $n "$WORK/chain_$n.vsop"
+    time=$(measure "$WORK/chain_$n.vsop")
+    echo "chain of $n calls: $time ms"
+
+    # Below a few milliseconds, the start of the process dominates
+    if [ -n "$previous" ] && [ "$previous" -ge 5 ] && [ "$time" -gt $((8 * previous)) ]; then
+        echo "chained_calls: the time grows faster than the length of the chain" >&2
+        status=1
+    fi
+
+    previous=$time
+done
+
+exit $status
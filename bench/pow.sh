@@ -0,0 +1,179 @@
+#!/bin/bash
+#
+# Check and micro-benchmark of the lowering of ^ (CodeGenerator::create_pow).
+#
+# Usage: bench/pow.sh [path to vsopc]
+#
+# The check compiles, at -O0 and -O2, a program which computes a ^ b for
+# random operands through each lowering: both operands constant (folded),
+# constant exponent (unrolled), constant power of two as base (shift),
+# and both operands read at run time (vsop.pow). The results are compared
+# with a reference which multiplies b times with int32 wrapping, and gives
+# the integer part of 1/a^-b for a negative exponent. SEED makes a run
+# reproducible.
+#
+# The benchmark sums a ^ b over a loop, with the operands only known at
+# run time, and compares it with the same loop in C through
+# __builtin_powi, which is the former llvm.powi.f64 lowering.
+
+VSOPC=${1:-$(dirname "$0")/../src/vsopc}
+SEED=${SEED:-$RANDOM}
+CASES=${CASES:-200}
+ITERATIONS=${ITERATIONS:-20000000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ ! -x "$VSOPC" ]; then
+    echo "pow: vsopc not found at $VSOPC" >&2
+    exit 1
+fi
+
+RANDOM=$SEED
+echo "pow: seed $SEED"
+
+# a ^ b with int32 wrapping, by repeated multiplication
+reference(){
+    local a=$1 b=$2 result=1 i
+
+    if [ "$b" -lt 0 ]; then
+        if [ "$a" -eq 1 ]; then
+            echo 1
+        elif [ "$a" -eq -1 ]; then
+            echo $(( b % 2 == 0 ? 1 : -1 ))
+        else
+            echo 0
+        fi
+        return
+    fi
+
+    for ((i = 0; i < b; i++)); do
+        result=$(( (result * a) & 0xFFFFFFFF ))
+        (( result >= 0x80000000 )) && result=$(( result - 0x100000000 ))
+    done
+
+    echo "$result"
+}
+
+# Draws the operands a and b in the shell itself, a subshell would not
+# advance RANDOM. The base is small most of the time so that the results
+# do not all wrap to 0, the exponent is negative one time out of eight.
+random_operands(){
+    case $(( RANDOM % 8 )) in
+        0) a=$(( (RANDOM << 15 | RANDOM) - (1 << 29) )) ;;
+        1) a=$(( RANDOM % 3 - 1 )) ;;
+        *) a=$(( RANDOM % 41 - 20 )) ;;
+    esac
+
+    b=$(( RANDOM % 8 == 0 ? -(RANDOM % 5) - 1 : RANDOM % 70 ))
+}
+
+# The program, its input and the expected output
+{
+    echo "class Main {"
+    echo "    main() : int32 {"
+
+    for ((n = 0; n < CASES; n++)); do
+        random_operands
+        shift_base=$(( 1 << (RANDOM % 5 + 1) ))
+
+        echo "        printInt32(($a) ^ ($b)).print(\"\\n\");"
+        echo "        printInt32(inputInt32() ^ ($b)).print(\"\\n\");"
+        echo "        printInt32($shift_base ^ inputInt32()).print(\"\\n\");"
+        echo "        printInt32(inputInt32() ^ inputInt32()).print(\"\\n\");"
+
+        echo "$a $b $a $b" >&4
+
+        expected=$(reference "$a" "$b")
+        echo "$expected" >&5
+        echo "$expected" >&5
+        reference "$shift_base" "$b" >&5
+        echo "$expected" >&5
+    done
+
+    echo "        0"
+    echo "    }"
+    echo "}"
+} > "$WORK/check.vsop" 4> "$WORK/check.in" 5> "$WORK/check.expected"
+
+status=0
+
+for level in -O0 -O2; do
+    "$VSOPC" $level "$WORK/check.vsop" > /dev/null || exit 1
+
+    if "$WORK/check" < "$WORK/check.in" | cmp -s - "$WORK/check.expected"; then
+        echo "check $level: $((4 * CASES)) results match the reference"
+    else
+        echo "pow: results of $level differ from the reference (SEED=$SEED):" >&2
+        "$WORK/check" < "$WORK/check.in" | diff - "$WORK/check.expected" | head -20 >&2
+        status=1
+    fi
+done
+
+# The benchmark: the operands stay below 7 ^ 11 so that no lowering overflows
+cat > "$WORK/loop.vsop" <<EOF
+class Main {
+    main() : int32 {
+        let n : int32 <- inputInt32() in
+        let sum : int32 <- 0 in
+        let i : int32 <- 0 in {
+            while i < n do {
+                sum <- sum + (i - i / 7 * 7) ^ (i - i / 11 * 11);
+                i <- i + 1
+            };
+            printInt32(sum).print("\n");
+            0
+        }
+    }
+}
+EOF
+
+cat > "$WORK/loop_powi.c" <<EOF
+#include <stdio.h>
+
+int main(void){
+    int n, sum = 0;
+
+    if (scanf("%d", &n) != 1)
+        return 1;
+
+    for (int i = 0; i < n; i++)
+        sum += (int) __builtin_powi((double) (i % 7), i % 11);
+
+    printf("%d\n", sum);
+    return 0;
+}
+EOF
+
+"$VSOPC" "$WORK/loop.vsop" > /dev/null || exit 1
+clang -O2 -fwrapv "$WORK/loop_powi.c" -o "$WORK/loop_powi" || exit 1
+
+# Best of 3 runs, in milliseconds
+measure(){
+    local program=$1 best=""
+
+    for run in 1 2 3; do
+        local start=$(date +%s%N)
+        echo "$ITERATIONS" | "$program" > "$WORK/result" || exit 1
+        local time=$(( ($(date +%s%N) - start) / 1000000 ))
+
+        if [ -z "$best" ] || [ "$time" -lt "$best" ]; then
+            best=$time
+        fi
+    done
+
+    echo "$best"
+}
+
+time_pow=$(measure "$WORK/loop")
+result_pow=$(cat "$WORK/result")
+time_powi=$(measure "$WORK/loop_powi")
+result_powi=$(cat "$WORK/result")
+
+echo "$ITERATIONS powers: vsop.pow $time_pow ms, llvm.powi.f64 $time_powi ms"
+
+if [ "$result_pow" != "$result_powi" ]; then
+    echo "pow: the loop sums to $result_pow instead of $result_powi" >&2
+    status=1
+fi
+
+exit $status
@@ -0,0 +1,66 @@
+#include "Arena.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+// Arena class
+
+Arena::Arena(size_t block_size): block_size(block_size) {}
+
+Arena::~Arena(){
+    clear();
+}
+
+void* Arena::allocate(size_t size, size_t alignment){
+
+    uintptr_t address = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    if (cursor == nullptr || address + size > reinterpret_cast<uintptr_t>(limit)){
+
+        // Start a new block, large enough for objects bigger than the usual block
+        size_t size_block = max(block_size, size + alignment);
+        char* block = static_cast<char*>(malloc(size_block));
+
+        if (block == nullptr)
+            abort();
+
+        blocks.push_back(block);
+        bytes_reserved += size_block;
+
+        cursor = block;
+        limit = block + size_block;
+        address = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    cursor = reinterpret_cast<char*>(address + size);
+    bytes_used += size;
+
+    return reinterpret_cast<void*>(address);
+}
+
+const char* Arena::copy(const string& text){
+
+    char* copy = static_cast<char*>(allocate(text.size() + 1, 1));
+    memcpy(copy, text.data(), text.size());
+    copy[text.size()] = '\0';
+
+    return copy;
+}
+
+void Arena::clear(){
+
+    // Destroy in reverse order of creation, like the members of an object
+    for (auto it = destructors.rbegin(); it != destructors.rend(); it++)
+        it->destroy(it->object);
+
+    for (char* block : blocks)
+        free(block);
+
+    destructors.clear();
+    blocks.clear();
+    cursor = limit = nullptr;
+    nb_objects = bytes_used = bytes_reserved = 0;
+}
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+/**
+ * Bump allocator which owns all the nodes of an AST.
+ *
+ * Nodes are placed one after the other inside large blocks, and the
+ * tree only holds non-owning pointers between them. Everything is
+ * released at once when the Arena is cleared or destroyed. Only the
+ * objects which are not trivially destructible are destroyed one by one.
+ */
+class Arena{
+
+    public:
+
+            size_t nb_objects = 0;      // Number of objects created in the Arena
+            size_t bytes_used = 0;      // Bytes given to the objects
+            size_t bytes_reserved = 0;  // Bytes of all the blocks
+
+            /**
+             * Creates a new Arena
+             *
+             * @param block_size The size of the blocks that are reserved
+             *
+             * @returns a new empty Arena
+             */
+            explicit Arena(size_t block_size = 64 * 1024);
+
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            ~Arena();   // Destructor
+
+            /**
+             * Creates a new object inside the Arena
+             *
+             * @tparam T The type of the object
+             * @param args The arguments given to the constructor of T
+             *
+             * @returns A pointer to the object, owned by the Arena
+             */
+            template <typename T, typename... Args>
+            T* make(Args&&... args){
+
+                T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+                // Only the objects that own memory themselves need to be destroyed
+                if (!std::is_trivially_destructible<T>::value)
+                    destructors.push_back({object, [](void* ptr){ static_cast<T*>(ptr)->~T(); }});
+
+                nb_objects++;
+                return object;
+            }
+
+            /**
+             * Reserves raw memory inside the Arena
+             *
+             * @param size The number of bytes
+             * @param alignment The alignment of the memory
+             *
+             * @returns A pointer to the memory
+             */
+            void* allocate(size_t size, size_t alignment);
+
+            /**
+             * Copies a text inside the Arena
+             *
+             * @param text The text
+             *
+             * @returns The copy, followed by a '\0'
+             */
+            const char* copy(const std::string& text);
+
+            /**
+             * Destroys all the objects and releases all the blocks
+             */
+            void clear();
+
+    private:
+
+            struct Destructor{
+                void* object;
+                void (*destroy)(void*);
+            };
+
+            size_t block_size;
+            char* cursor = nullptr;
+            char* limit = nullptr;
+            std::vector<char*> blocks;
+            std::vector<Destructor> destructors;
+};
+
+/**
+ * Growable array whose elements live inside an Arena, so that it needs
+ * no destructor. Growing copies the elements to a new array and leaves
+ * the old one to the Arena. A copy of an ArenaVector shares the elements.
+ *
+ * @tparam T The type of the elements, trivially copyable (pointers)
+ */
+template <typename T>
+class ArenaVector{
+
+    public:
+
+            typedef T* iterator;
+            typedef std::reverse_iterator<T*> reverse_iterator;
+
+            /**
+             * Creates an empty ArenaVector
+             *
+             * @param arena The Arena of the elements, only needed to push
+             */
+            explicit ArenaVector(Arena* arena = nullptr): arena(arena) {}
+
+            T* begin() const { return elements; }
+            T* end() const { return elements + count; }
+            reverse_iterator rbegin() const { return reverse_iterator(end()); }
+            reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+            size_t size() const { return count; }
+            bool empty() const { return count == 0; }
+            T& operator[](size_t index) const { return elements[index]; }
+            T& front() const { return elements[0]; }
+            T& back() const { return elements[count - 1]; }
+
+            /**
+             * Adds an element at the end
+             *
+             * @param element The element
+             */
+            void push_back(const T& element){
+
+                if (count == capacity){
+                    assert(arena != nullptr);
+
+                    capacity = capacity == 0 ? 4 : 2 * capacity;
+                    T* grown = static_cast<T*>(arena->allocate(capacity * sizeof(T), alignof(T)));
+
+                    if (count > 0)
+                        memcpy(grown, elements, count * sizeof(T));
+
+                    elements = grown;
+                }
+
+                elements[count++] = element;
+            }
+
+            /**
+             * Removes an element
+             *
+             * @param position The element
+             *
+             * @returns The element which followed it
+             */
+            T* erase(T* position){
+                memmove(position, position + 1, (end() - position - 1) * sizeof(T));
+                count--;
+                return position;
+            }
+
+    private:
+
+            Arena* arena;
+            T* elements = nullptr;
+            size_t count = 0;
+            size_t capacity = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,318 @@
+#include "Cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "llvm/Support/SHA1.h"
+
+// Changes with every build of vsopc, unless the build gives its own version
+#ifndef VSOPC_VERSION
+#define VSOPC_VERSION __DATE__ " " __TIME__
+#endif
+
+using namespace std;
+
+/**
+ * Entry of the cache, as seen when it is evicted.
+ */
+struct Entry{
+    string path;
+    uint64_t size;
+    time_t last_use;
+};
+
+static bool read_file(const string& path, string& content){
+
+    ifstream input(path, ios::binary);
+
+    if (!input)
+        return false;
+
+    ostringstream buffer;
+    buffer << input.rdbuf();
+    content = buffer.str();
+
+    return !input.bad();
+}
+
+/**
+ * Writes a file aside and renames it, so that no other process sees it half written
+ *
+ * @param path The path of the file
+ * @param content The content of the file
+ * @param mode The permissions of the file
+ *
+ * @returns true if the file has been written, false else
+ */
+static bool write_file(const string& path, const string& content, mode_t mode){
+
+    string temporary = path + ".tmp." + to_string(getpid()) + "." + to_string(hash<thread::id>()(this_thread::get_id()));
+
+    {
+        ofstream output(temporary, ios::binary | ios::trunc);
+        output << content;
+
+        if (!output.good()){
+            unlink(temporary.c_str());
+            return false;
+        }
+    }
+
+    if (chmod(temporary.c_str(), mode) != 0 || rename(temporary.c_str(), path.c_str()) != 0){
+        unlink(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+static bool copy_file(const string& from, const string& to){
+
+    struct stat status;
+    string content;
+
+    if (stat(from.c_str(), &status) != 0 || !read_file(from, content))
+        return false;
+
+    return write_file(to, content, status.st_mode & 0777);
+}
+
+/**
+ * Hashes the runtime that the programs are linked with, once per process
+ *
+ * @returns The raw SHA-1 of the installed runtime
+ */
+static const string& runtime_hash(){
+
+    static const string hash = [](){
+        llvm::SHA1 hasher;
+
+        for (const char* file : {"/vsop/object.bc", "/vsop/object.s", "/vsop/object.o", "/vsop/alloc.o", "/vsop/gc.o"}){
+            string content;
+            read_file(file, content);
+
+            hasher.update(file);
+            hasher.update(llvm::StringRef(content.data(), content.size() + 1));     // With the '\0', so that the files cannot shift
+        }
+
+        return hasher.final().str();
+    }();
+
+    return hash;
+}
+
+static vector<Entry> entries(const string& directory){
+
+    vector<Entry> found;
+    DIR* dir = opendir(directory.c_str());
+
+    if (dir == nullptr)
+        return found;
+
+    while (struct dirent* item = readdir(dir)){
+
+        string path = directory + "/" + item->d_name;
+        struct stat status;
+
+        if (item->d_name[0] == '.' || stat(path.c_str(), &status) != 0 || !S_ISDIR(status.st_mode))
+            continue;
+
+        Entry entry = {path, 0, status.st_mtime};
+        DIR* files = opendir(path.c_str());
+
+        while (files != nullptr){
+
+            struct dirent* file = readdir(files);
+
+            if (file == nullptr)
+                break;
+
+            struct stat file_status;
+
+            if (stat((path + "/" + file->d_name).c_str(), &file_status) == 0 && S_ISREG(file_status.st_mode))
+                entry.size += file_status.st_size;
+        }
+
+        if (files != nullptr)
+            closedir(files);
+
+        found.push_back(entry);
+    }
+
+    closedir(dir);
+
+    return found;
+}
+
+static void remove_entry(const string& path){
+
+    DIR* dir = opendir(path.c_str());
+
+    if (dir == nullptr)
+        return;
+
+    while (struct dirent* file = readdir(dir))
+        if (file->d_name[0] != '.')
+            unlink((path + "/" + file->d_name).c_str());
+
+    closedir(dir);
+    rmdir(path.c_str());
+}
+
+// Cache class
+
+Cache::Cache(const string& directory, uint64_t max_size): directory(directory), max_size(max_size){
+    mkdir(directory.c_str(), 0755);
+}
+
+string Cache::key(llvm::StringRef source, const string& flags){
+
+    llvm::SHA1 hasher;
+    const char separator = '\0';
+
+    hasher.update(VSOPC_VERSION);
+    hasher.update(llvm::StringRef(&separator, 1));
+    hasher.update(runtime_hash());
+    hasher.update(flags);
+    hasher.update(llvm::StringRef(&separator, 1));
+    hasher.update(source);
+
+    ostringstream text;
+
+    for (unsigned char byte : hasher.final())
+        text << setw(2) << setfill('0') << hex << (int) byte;
+
+    return text.str();
+}
+
+bool Cache::fetch(const string& key, const Files& files){
+
+    string entry = directory + "/" + key;
+    bool hit = true;
+
+    for (size_t i = 0; hit && i < files.size(); i++)
+        hit = copy_file(entry + "/" + files[i].first, files[i].second);
+
+    // Marks the entry as the most recently used
+    if (hit)
+        utime(entry.c_str(), nullptr);
+
+    count(hit ? HITS : MISSES);
+
+    return hit;
+}
+
+bool Cache::fetch(const string& key, const string& name, string& text){
+
+    string entry = directory + "/" + key;
+    bool hit = read_file(entry + "/" + name, text);
+
+    if (hit)
+        utime(entry.c_str(), nullptr);
+
+    count(hit ? HITS : MISSES);
+
+    return hit;
+}
+
+void Cache::store(const string& key, const Files& files){
+
+    string entry = directory + "/" + key;
+    mkdir(entry.c_str(), 0755);
+
+    for (auto& file : files)
+        if (!copy_file(file.second, entry + "/" + file.first)){
+            // A partial entry would only be a miss, it is not worth its space
+            remove_entry(entry);
+            return;
+        }
+
+    if (count(STORES) % EVICTION_PERIOD == 0)
+        evict();
+}
+
+void Cache::store(const string& key, const string& name, const string& text){
+
+    string entry = directory + "/" + key;
+    mkdir(entry.c_str(), 0755);
+
+    if (write_file(entry + "/" + name, text, 0644) && count(STORES) % EVICTION_PERIOD == 0)
+        evict();
+}
+
+void Cache::report(ostream& output){
+
+    unsigned long hits = 0, misses = 0;
+    string stats;
+
+    if (read_file(directory + "/stats", stats))
+        sscanf(stats.c_str(), "%lu %lu", &hits, &misses);
+
+    uint64_t size = 0;
+    vector<Entry> all = entries(directory);
+
+    for (auto& entry : all)
+        size += entry.size;
+
+    output << "vsopc: cache " << directory << ": " << hits << " hits, " << misses << " misses, "
+           << all.size() << " entries, " << size << " bytes (limit " << max_size << ")" << endl;
+}
+
+unsigned long Cache::count(Counter counter){
+
+    int fd = open((directory + "/stats").c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+        return 0;
+
+    // The other processes that use the cache wait for the update
+    flock(fd, LOCK_EX);
+
+    char buffer[96] = {0};
+    unsigned long counters[3] = {0, 0, 0};      // Hits, misses, stores
+
+    if (read(fd, buffer, sizeof(buffer) - 1) > 0)
+        sscanf(buffer, "%lu %lu %lu", &counters[HITS], &counters[MISSES], &counters[STORES]);
+
+    counters[counter]++;
+
+    string stats = to_string(counters[HITS]) + " " + to_string(counters[MISSES]) + " " + to_string(counters[STORES]) + "\n";
+
+    if (lseek(fd, 0, SEEK_SET) == 0 && ftruncate(fd, 0) == 0 && write(fd, stats.data(), stats.size()) < 0)
+        cerr << "vsopc: cannot update the statistics of the cache" << endl;
+
+    close(fd);
+
+    return counters[counter];
+}
+
+void Cache::evict(){
+
+    vector<Entry> all = entries(directory);
+    uint64_t size = 0;
+
+    for (auto& entry : all)
+        size += entry.size;
+
+    if (size <= max_size)
+        return;
+
+    sort(all.begin(), all.end(), [](const Entry& a, const Entry& b){
+        return a.last_use < b.last_use;
+    });
+
+    for (size_t i = 0; i < all.size() && size > max_size; i++){
+        remove_entry(all[i].path);
+        size -= all[i].size;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+
+/**
+ * On-disk cache of the artifacts of the compilations.
+ *
+ * An entry is a directory named after a SHA-1 of everything the
+ * artifacts depend on: the source, the version of vsopc, the flags and
+ * the runtime. It holds the files of one compilation (object file,
+ * executable, textual IR). The entries which have not been used for the
+ * longest time are removed once the cache is larger than its limit. The
+ * size is only computed every few stores, as it reads the whole cache,
+ * so the limit may be passed by the last entries stored.
+ *
+ * Several processes and threads may use the same cache: the files are
+ * written aside and renamed, and an entry that cannot be read entirely
+ * is a miss.
+ */
+class Cache{
+
+    public:
+
+            typedef std::vector<std::pair<std::string, std::string>> Files;    // Name in the entry, path outside
+
+            /**
+             * Opens a cache, which is created if needed
+             *
+             * @param directory The directory of the cache
+             * @param max_size The size beyond which the oldest entries are removed, in bytes
+             */
+            Cache(const std::string& directory, uint64_t max_size);
+
+            /**
+             * Computes the key of a compilation
+             *
+             * @param source The content of the source file
+             * @param flags The flags that change the artifacts
+             *
+             * @returns The key, in hexadecimal
+             */
+            std::string key(llvm::StringRef source, const std::string& flags);
+
+            /**
+             * Copies the files of an entry where the compilation would have written them
+             *
+             * @param key The key of the compilation
+             * @param files The files to copy
+             *
+             * @returns true if all the files are in the cache (hit), false else (miss)
+             */
+            bool fetch(const std::string& key, const Files& files);
+
+            /**
+             * Reads a text of an entry, the textual IR
+             *
+             * @param key The key of the compilation
+             * @param name The name of the text in the entry
+             * @param text Receives the text
+             *
+             * @returns true if the text is in the cache (hit), false else (miss)
+             */
+            bool fetch(const std::string& key, const std::string& name, std::string& text);
+
+            /**
+             * Copies the artifacts of a compilation in its entry, then
+             * removes the oldest entries if the cache is too large, every
+             * EVICTION_PERIOD stores
+             *
+             * @param key The key of the compilation
+             * @param files The files to copy, nothing is stored if one of them is missing
+             */
+            void store(const std::string& key, const Files& files);
+
+            /**
+             * Writes a text in an entry, then removes the oldest entries if the cache is too large,
+             * every EVICTION_PERIOD stores
+             *
+             * @param key The key of the compilation
+             * @param name The name of the text in the entry
+             * @param text The text
+             */
+            void store(const std::string& key, const std::string& name, const std::string& text);
+
+            /**
+             * Prints the hits and misses since the cache has been created, and its size
+             *
+             * @param output The stream where the statistics are written
+             */
+            void report(std::ostream& output);
+
+    private:
+
+            enum Counter {HITS, MISSES, STORES};
+
+            static const unsigned long EVICTION_PERIOD = 16;   // Stores between two computations of the size of the cache
+
+            std::string directory;
+            uint64_t max_size;
+
+            /**
+             * Adds one to a counter of the statistics kept in the cache,
+             * shared by all the processes which use it
+             *
+             * @param counter The counter
+             *
+             * @returns The new value of the counter, 0 if it cannot be updated
+             */
+            unsigned long count(Counter counter);
+
+            /**
+             * Removes the least recently used entries until the cache fits its limit
+             */
+            void evict();
+};
+
+#endif
\ No newline at end of file
@@ -1,4 +1,32 @@
 #include "CodeGenerator.hpp"
+#include "utils.hpp"
+
+// Functions of the runtime (object.s), which is linked inside vsopc for the JIT
+extern "C" {
+    void Object_print();
+    void Object_printBool();
+    void Object_printInt32();
+    void Object_inputLine();
+    void Object_inputBool();
+    void Object_inputInt32();
+    void Object__new();
+    void Object__init();
+    void vsop_alloc();
+    void vsop_alloc_slow();
+}
+
+static const std::vector<std::pair<const char*, void (*)()>> runtime_symbols = {
+    {"Object_print", Object_print},
+    {"Object_printBool", Object_printBool},
+    {"Object_printInt32", Object_printInt32},
+    {"Object_inputLine", Object_inputLine},
+    {"Object_inputBool", Object_inputBool},
+    {"Object_inputInt32", Object_inputInt32},
+    {"Object__new", Object__new},
+    {"Object__init", Object__init},
+    {"vsop_alloc", vsop_alloc},
+    {"vsop_alloc_slow", vsop_alloc_slow}
+};
 
 bool is_int32(llvm::Type* type){
 
@@ -40,19 +68,19 @@ bool is__class(llvm::Type* type){
         return false;
 }
 
-std::string type_to_string(llvm::Type* type){
+Symbol type_to_symbol(llvm::Type* type){
     if(is_int32(type))
-        return "int32";
+        return symbols::INT32;
     if (is_bool(type))
-        return "bool";
+        return symbols::BOOL;
     if (is_string(type))
-        return "string";
+        return symbols::STRING;
     if (is__class(type)){
-        std::string class_name = type->getPointerElementType()->getStructName().str();
-        return class_name.substr(class_name.find_first_of('.') + 1, std::string::npos);
+        llvm::StringRef class_name = type->getPointerElementType()->getStructName();
+        return Symbol::intern(class_name.substr(class_name.find_first_of('.') + 1).str());
     }
 
-    return "unit";
+    return symbols::UNIT;
 }
 
 bool is_same_as(llvm::Type* type_1, llvm::Type* type_2){
@@ -71,59 +99,80 @@ bool is_same_as(llvm::Type* type_1, llvm::Type* type_2){
     return false;
 }
 
+/**
+ * Prints a diagnostic of LLVM (linker, backend) with the errors of the
+ * file being compiled, instead of on the standard error of vsopc
+ */
+static void print_diagnostic(const llvm::DiagnosticInfo& info, void* context){
+
+    // Remarks are only for the optimization reports, which vsopc does not ask for
+    if (info.getSeverity() == llvm::DS_Remark)
+        return;
+
+    llvm::raw_os_ostream errors(*diagnostics);
+    llvm::DiagnosticPrinterRawOStream printer(errors);
+
+    errors << (info.getSeverity() == llvm::DS_Error ? "vsopc: error: " : info.getSeverity() == llvm::DS_Warning ? "vsopc: warning: " : "vsopc: note: ");
+    info.print(printer);
+    errors << "\n";
+}
+
 CodeGenerator::CodeGenerator(const std::string& name){
-    context = std::make_shared<llvm::LLVMContext>();
+    context = std::make_unique<llvm::LLVMContext>();
+    // Without a handler, LLVM exits on the first error, which would stop a server
+    context->setDiagnosticHandlerCallBack(print_diagnostic);
     builder = std::make_shared<llvm::IRBuilder<>>(*context);
-    module = std::make_shared<llvm::Module>(name, *context);
-}
+    module = std::make_unique<llvm::Module>(name, *context);
 
-void CodeGenerator::insert(const std::string& var, llvm::Value* val){
+    // Initialize the host target once, so that the module has the right layout from the start
+    static bool target_initialized = !llvm::InitializeNativeTarget() && !llvm::InitializeNativeTargetAsmPrinter();
 
-    if (look_up(var)){
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, error);
 
-        scope.at(var).push_back(val);
+    if (target_initialized && target != nullptr){
 
-    }else{
+        llvm::TargetOptions options;
+        target_machine.reset(target->createTargetMachine(triple, "generic", "", options, llvm::None));
 
-        scope.insert({var, {val}});
+        module->setTargetTriple(triple);
+        module->setDataLayout(target_machine->createDataLayout());
     }
 }
 
-bool CodeGenerator::look_up(const std::string& var){
-
-    if (scope.find(var) == scope.end())
-        return false;
-
-    else
-        return true;
+void CodeGenerator::insert(Symbol var, llvm::Value* val){
+    scope.insert(var, val);
 }
 
-void CodeGenerator::remove(const std::string& var){
-
-    if (!look_up(var))
-        return;
+bool CodeGenerator::look_up(Symbol var){
+    return scope.look_up(var);
+}
 
-    if (scope.at(var).size() > 1){
+void CodeGenerator::remove(Symbol var){
+    scope.remove(var);
+}
 
-        scope.at(var).pop_back();
+void CodeGenerator::release(Symbol var){
 
-    }else{
+    if (look_up(var))
+        if (llvm::AllocaInst* slot = llvm::dyn_cast_or_null<llvm::AllocaInst>(scope.get(var)))
+            free_slots[slot->getAllocatedType()].push_back(slot);
 
-        scope.erase(var);
-    }
+    remove(var);
 }
 
-llvm::Value* CodeGenerator::get_val(const std::string& var){
+llvm::Value* CodeGenerator::get_val(Symbol var){
 
     if (look_up(var))
-        return scope.at(var).back();
+        return scope.get(var);
 
     else
 
         return nullptr;
 }
 
-llvm::Type* CodeGenerator::get_type(const std::string& var){
+llvm::Type* CodeGenerator::get_type(Symbol var){
 
     if (llvm::Value* val = get_val(var))
         return val->getType()->getPointerElementType();
@@ -131,7 +180,28 @@ llvm::Type* CodeGenerator::get_type(const std::string& var){
     return nullptr;
 }
 
-void CodeGenerator::allocate(const std::string& var, llvm::Type* type){
+llvm::AllocaInst* CodeGenerator::create_slot(llvm::Type* type){
+
+    enter_frame();
+
+    llvm::Function* function = frame;
+    std::vector<llvm::AllocaInst*>& slots = free_slots[type];
+
+    if (!slots.empty()){
+        llvm::AllocaInst* slot = slots.back();
+        slots.pop_back();
+        return slot;
+    }
+
+    if (gc && is__class(type))
+        return create_root(type);
+
+    llvm::IRBuilder<> entry_builder(&function->getEntryBlock(), function->getEntryBlock().begin());
+
+    return entry_builder.CreateAlloca(type);
+}
+
+void CodeGenerator::allocate(Symbol var, llvm::Type* type){
 
     if (is_unit(type))
 
@@ -139,16 +209,16 @@ void CodeGenerator::allocate(const std::string& var, llvm::Type* type){
 
     else
 
-        insert(var, builder->CreateAlloca(type));
+        insert(var, create_slot(type));
 }
 
-void CodeGenerator::store(const std::string& var, llvm::Value* val){
+void CodeGenerator::store(Symbol var, llvm::Value* val){
 
     if (llvm::Value* _val = get_val(var))
         builder->CreateStore(val, _val);
 }
 
-llvm::Value* CodeGenerator::load(const std::string &var){
+llvm::Value* CodeGenerator::load(Symbol var){
 
     if (llvm::Value* _val = get_val(var))
         return builder->CreateLoad(_val);
@@ -156,21 +226,21 @@ llvm::Value* CodeGenerator::load(const std::string &var){
     return nullptr;
 }
 
-llvm::Type* CodeGenerator::to_type(const std::string& type){
+llvm::Type* CodeGenerator::to_type(Symbol type){
 
-    if (type == "int32")
+    if (type == symbols::INT32)
         return llvm::Type::getInt32Ty(*context);
 
-    if (type == "string")
+    if (type == symbols::STRING)
         return llvm::Type::getInt8PtrTy(*context);
 
-    if (type == "bool")
+    if (type == symbols::BOOL)
         return llvm::Type::getInt1Ty(*context);
 
-    if (type == "unit")
+    if (type == symbols::UNIT)
         return llvm::Type::getVoidTy(*context);
 
-    llvm::StructType* _class = module->getTypeByName("struct." + type);
+    llvm::StructType* _class = module->getTypeByName("struct." + type.str());
 
     if (_class != nullptr)
         return _class->getPointerTo();
@@ -182,7 +252,7 @@ llvm::Type* CodeGenerator::to_type(const std::string& type){
 llvm::Value* CodeGenerator::default_val(llvm::Type* type){
 
     if (is_string(type))
-        return builder->CreateGlobalStringPtr("", "str");
+        return string_constant("");
 
     if (is_bool(type) || is_int32(type))
         return llvm::Constant::getNullValue(type);
@@ -193,11 +263,32 @@ llvm::Value* CodeGenerator::default_val(llvm::Type* type){
     return nullptr;
 }
 
-llvm::Value* CodeGenerator::default_val(const std::string& type){
+llvm::Value* CodeGenerator::default_val(Symbol type){
 
     return default_val(to_type(type));
 }
 
+llvm::Constant* CodeGenerator::string_constant(const std::string& text){
+
+    auto it = string_pool.find(text);
+
+    if (it != string_pool.end())
+        return it->second;
+
+    llvm::Constant* data = llvm::ConstantDataArray::getString(*context, text);
+    llvm::GlobalVariable* global = new llvm::GlobalVariable(*module, data->getType(), true, llvm::GlobalValue::PrivateLinkage, data, "str");
+
+    // Only the content matters, so LLVM may merge it with other constants
+    global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+
+    llvm::Constant* zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 0);
+    llvm::Constant* pointer = llvm::ConstantExpr::getInBoundsGetElementPtr(data->getType(), global, llvm::ArrayRef<llvm::Constant*>({zero, zero}));
+
+    string_pool[text] = pointer;
+
+    return pointer;
+}
+
 std::string CodeGenerator::print(){
 
     std::string text;
@@ -206,18 +297,479 @@ std::string CodeGenerator::print(){
     return output.str();
 }
 
-void CodeGenerator::optimizer(){
+llvm::Value* CodeGenerator::create_alloc(uint64_t size, llvm::Constant* map){
+
+    llvm::Type* int8_ptr = llvm::Type::getInt8PtrTy(*context);
+    llvm::Type* int64 = llvm::Type::getInt64Ty(*context);
+    llvm::FunctionType* alloc_type = llvm::FunctionType::get(int8_ptr, {int64}, false);
+
+    if (gc){
+        // May collect before allocating, so every object must be rooted at this point
+        llvm::Constant* _map = map != nullptr ? llvm::ConstantExpr::getPointerCast(map, int8_ptr) : llvm::ConstantPointerNull::get((llvm::PointerType*) int8_ptr);
+
+        return builder->CreateCall(
+                module->getOrInsertFunction("vsop_gc_alloc", llvm::FunctionType::get(int8_ptr, {int64, int8_ptr}, false)),
+                {llvm::ConstantInt::get(int64, size), _map}
+        );
+    }
+
+    if (!bump_alloc)
+        return builder->CreateCall(module->getOrInsertFunction("malloc", alloc_type), {llvm::ConstantInt::get(int64, size)});
+
+    // Same rounding as the runtime: multiples of 16 bytes, up to 256 in the regions
+    size = std::max<uint64_t>((size + 15) & ~(uint64_t) 15, 16);
+
+    if (!inline_alloc || size > 256)
+        return builder->CreateCall(module->getOrInsertFunction("vsop_alloc", alloc_type), {llvm::ConstantInt::get(int64, size)});
+
+    // Bounds of the region of the current thread, defined by the runtime
+    llvm::GlobalVariable* bounds[2];
+    const char* names[2] = {"vsop_alloc_cursor", "vsop_alloc_limit"};
+
+    for (int i = 0; i < 2; i++){
+        bounds[i] = module->getNamedGlobal(names[i]);
+
+        if (bounds[i] == nullptr)
+            bounds[i] = new llvm::GlobalVariable(*module, int8_ptr, false, llvm::GlobalValue::ExternalLinkage, nullptr, names[i],
+                                                 nullptr, llvm::GlobalValue::InitialExecTLSModel);
+    }
+
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* fast_block = llvm::BasicBlock::Create(*context, "alloc.fast", function);
+    llvm::BasicBlock* slow_block = llvm::BasicBlock::Create(*context, "alloc.slow", function);
+    llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*context, "alloc.end", function);
+
+    // The object fits if cursor + size does not go past the limit
+    llvm::Value* cursor = builder->CreateLoad(int8_ptr, bounds[0]);
+    llvm::Value* next = builder->CreateGEP(llvm::Type::getInt8Ty(*context), cursor, llvm::ConstantInt::get(int64, size));
+    llvm::Value* fits = builder->CreateICmpULE(next, builder->CreateLoad(int8_ptr, bounds[1]));
+
+    builder->CreateCondBr(fits, fast_block, slow_block, llvm::MDBuilder(*context).createBranchWeights(1000, 1));
+
+    builder->SetInsertPoint(fast_block);
+    builder->CreateStore(next, bounds[0]);
+    builder->CreateBr(end_block);
+
+    builder->SetInsertPoint(slow_block);
+    llvm::Value* slow = builder->CreateCall(module->getOrInsertFunction("vsop_alloc_slow", alloc_type), {llvm::ConstantInt::get(int64, size)});
+    builder->CreateBr(end_block);
+
+    builder->SetInsertPoint(end_block);
+    llvm::PHINode* memory = builder->CreatePHI(int8_ptr, 2);
+    memory->addIncoming(cursor, fast_block);
+    memory->addIncoming(slow, slow_block);
+
+    return memory;
+}
+
+/**
+ * Defines vsop.pow(base, exponent) in the module, by squaring the base
+ * for each bit of the exponent
+ */
+static llvm::Function* pow_function(llvm::Module& module){
+
+    llvm::Function* function = module.getFunction("vsop.pow");
+
+    if (function != nullptr)
+        return function;
+
+    llvm::LLVMContext& context = module.getContext();
+    llvm::Type* int32 = llvm::Type::getInt32Ty(context);
+    llvm::Constant* zero = llvm::ConstantInt::get(int32, 0);
+    llvm::Constant* one = llvm::ConstantInt::get(int32, 1);
+
+    function = llvm::Function::Create(llvm::FunctionType::get(int32, {int32, int32}, false), llvm::Function::InternalLinkage, "vsop.pow", &module);
+    function->addFnAttr(llvm::Attribute::ReadNone);
+    function->addFnAttr(llvm::Attribute::NoUnwind);
+
+    llvm::Value* base = function->arg_begin();
+    llvm::Value* exponent = function->arg_begin() + 1;
+
+    llvm::BasicBlock* entry_block = llvm::BasicBlock::Create(context, "", function);
+    llvm::BasicBlock* negative_block = llvm::BasicBlock::Create(context, "negative", function);
+    llvm::BasicBlock* loop_block = llvm::BasicBlock::Create(context, "loop", function);
+    llvm::BasicBlock* body_block = llvm::BasicBlock::Create(context, "body", function);
+    llvm::BasicBlock* exit_block = llvm::BasicBlock::Create(context, "exit", function);
+
+    llvm::IRBuilder<> builder(entry_block);
+    builder.CreateCondBr(builder.CreateICmpSLT(exponent, zero), negative_block, loop_block);
+
+    // 1 / base^n truncates to 0, except for 1 and -1
+    builder.SetInsertPoint(negative_block);
+    llvm::Value* odd = builder.CreateAnd(exponent, one);
+    llvm::Value* sign = builder.CreateSub(one, builder.CreateShl(odd, one));
+    builder.CreateRet(builder.CreateSelect(
+            builder.CreateICmpEQ(base, llvm::ConstantInt::get(int32, -1)),
+            sign,
+            builder.CreateZExt(builder.CreateICmpEQ(base, one), int32)
+    ));
+
+    builder.SetInsertPoint(loop_block);
+    llvm::PHINode* result = builder.CreatePHI(int32, 2);
+    llvm::PHINode* square = builder.CreatePHI(int32, 2);
+    llvm::PHINode* bits = builder.CreatePHI(int32, 2);
+    builder.CreateCondBr(builder.CreateICmpEQ(bits, zero), exit_block, body_block);
+
+    // Multiply by base^(2^i) when the i-th bit of the exponent is set
+    builder.SetInsertPoint(body_block);
+    llvm::Value* next_result = builder.CreateSelect(
+            builder.CreateICmpNE(builder.CreateAnd(bits, one), zero),
+            builder.CreateMul(result, square),
+            result
+    );
+    llvm::Value* next_square = builder.CreateMul(square, square);
+    llvm::Value* next_bits = builder.CreateLShr(bits, one);
+    builder.CreateBr(loop_block);
+
+    result->addIncoming(one, entry_block);
+    result->addIncoming(next_result, body_block);
+    square->addIncoming(base, entry_block);
+    square->addIncoming(next_square, body_block);
+    bits->addIncoming(exponent, entry_block);
+    bits->addIncoming(next_bits, body_block);
+
+    builder.SetInsertPoint(exit_block);
+    builder.CreateRet(result);
+
+    return function;
+}
+
+llvm::Value* CodeGenerator::create_pow(llvm::Value* base, llvm::Value* exponent){
+
+    llvm::Type* int32 = llvm::Type::getInt32Ty(*context);
+
+    // Constant exponent: square and multiply at compile time
+    if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(exponent)){
+
+        int64_t bits = constant->getSExtValue();
+
+        if (bits >= 0){
+
+            llvm::Value* result = nullptr;
+
+            for (llvm::Value* square = base; bits != 0; bits >>= 1){
+
+                if (bits & 1)
+                    result = result == nullptr ? square : builder->CreateMul(result, square);
+
+                if (bits > 1)
+                    square = builder->CreateMul(square, square);
+            }
+
+            return result != nullptr ? result : llvm::ConstantInt::get(int32, 1);
+        }
+    }
+
+    // (2^k)^n is 1 << k*n, and wraps around to 0 from 2^32 on, or for negative n
+    if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(base)){
+
+        int64_t value = constant->getSExtValue();
+
+        if (value > 1 && (value & (value - 1)) == 0){
+
+            int64_t shift = 0;
+            while ((1LL << shift) != value)
+                shift++;
+
+            llvm::Value* fits = builder->CreateICmpULT(exponent, llvm::ConstantInt::get(int32, 31 / shift + 1));
+            llvm::Value* power = builder->CreateShl(llvm::ConstantInt::get(int32, 1), builder->CreateMul(exponent, llvm::ConstantInt::get(int32, shift)));
+
+            return builder->CreateSelect(fits, power, llvm::ConstantInt::get(int32, 0));
+        }
+    }
+
+    return builder->CreateCall(pow_function(*module), {base, exponent});
+}
+
+llvm::AllocaInst* CodeGenerator::create_stack_object(llvm::StructType* type){
+
+    llvm::BasicBlock& entry = builder->GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+
+    return entry_builder.CreateAlloca(type);
+}
+
+llvm::AllocaInst* CodeGenerator::create_root(llvm::Type* type){
+
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock& entry = function->getEntryBlock();
+    llvm::Type* int8_ptr = llvm::Type::getInt8PtrTy(*context);
+
+    // The roots are declared once, at the start of the function
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+
+    llvm::AllocaInst* slot = entry_builder.CreateAlloca(type);
+    entry_builder.CreateCall(
+            llvm::Intrinsic::getDeclaration(module.get(), llvm::Intrinsic::gcroot),
+            {entry_builder.CreatePointerCast(slot, int8_ptr->getPointerTo()), llvm::ConstantPointerNull::get((llvm::PointerType*) int8_ptr)}
+    );
+    entry_builder.CreateStore(llvm::ConstantPointerNull::get((llvm::PointerType*) type), slot);
+
+    // The frame of the function is pushed on the shadow stack
+    function->setGC("shadow-stack");
+
+    return slot;
+}
+
+void CodeGenerator::root(llvm::Value* value){
+
+    if (!gc || value == nullptr || !is__class(value->getType()))
+        return;
+
+    // The caller roots the arguments. A loaded object is rooted too: the variable or the
+    // field it comes from may be assigned before the temporary is used
+    llvm::Value* object = value->stripPointerCasts();
+
+    if (llvm::isa<llvm::Argument>(object) || llvm::isa<llvm::Constant>(object))
+        return;
 
-    llvm::legacy::FunctionPassManager optimizer(module.get());
+    enter_frame();
+
+    // The roots hold any class, so that a dead temporary is overwritten by the next one
+    llvm::Type* int8_ptr = llvm::Type::getInt8PtrTy(*context);
+    llvm::AllocaInst* slot;
+
+    if (free_roots.empty()){
+        slot = create_root(int8_ptr);
+    }else{
+        slot = free_roots.back();
+        free_roots.pop_back();
+    }
+
+    builder->CreateStore(builder->CreatePointerCast(value, int8_ptr), slot);
+    temporary_roots.push_back(slot);
+}
+
+size_t CodeGenerator::root_mark(){
+
+    if (!gc)
+        return 0;
+
+    enter_frame();
+
+    return temporary_roots.size();
+}
+
+void CodeGenerator::enter_frame(){
+
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+
+    // The slots and the roots of the previous function cannot be reused
+    if (function != frame){
+        frame = function;
+        free_slots.clear();
+        temporary_roots.clear();
+        free_roots.clear();
+    }
+}
+
+void CodeGenerator::release_roots(size_t mark){
+
+    while (temporary_roots.size() > mark){
+        free_roots.push_back(temporary_roots.back());
+        temporary_roots.pop_back();
+    }
+}
+
+const llvm::MemoryBuffer* CodeGenerator::load_runtime(const std::string& file_name){
+
+    static std::mutex lock;
+    static std::unordered_map<std::string, std::unique_ptr<llvm::MemoryBuffer>> loaded;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = loaded.find(file_name);
+
+    if (it != loaded.end())
+        return it->second.get();
+
+    llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(file_name);
+
+    if (!buffer)
+        return nullptr;
+
+    return (loaded[file_name] = std::move(*buffer)).get();
+}
+
+bool CodeGenerator::link_runtime(const std::string& file_name){
+
+    const llvm::MemoryBuffer* bitcode = load_runtime(file_name);
+
+    if (bitcode == nullptr)
+        return false;
+
+    // The module of the runtime belongs to the context, so it is parsed again for each compilation
+    llvm::SMDiagnostic error;
+    std::unique_ptr<llvm::Module> runtime = llvm::parseIR(bitcode->getMemBufferRef(), error, *context);
+
+    if (!runtime){
+        llvm::raw_os_ostream errors(*diagnostics);
+        error.print("vsopc", errors);
+        return false;
+    }
+
+    // The runtime is compiled for the host, like the module
+    runtime->setTargetTriple(module->getTargetTriple());
+    runtime->setDataLayout(module->getDataLayout());
+
+    // The declarations of the module are resolved to the definitions of the runtime
+    if (llvm::Linker::linkModules(*module, std::move(runtime)))
+        return false;
+
+    // An object file may be linked with other code, which can use the runtime
+    if (whole_program)
+        llvm::internalizeModule(*module, [](const llvm::GlobalValue& value){
+            return value.getName() == "main";
+        });
+
+    return true;
+}
+
+void CodeGenerator::optimizer(unsigned level){
+
+    level = std::min(level, 3u);
+
+    // The backend uses the same level as the IR pipeline
+    if (target_machine != nullptr)
+        target_machine->setOptLevel(static_cast<llvm::CodeGenOpt::Level>(level));
+
+    if (level == 0)
+        return;
+
+    // Nothing but main is called from outside, so the rest can be deleted or specialized
+    if (whole_program){
+        Span span("whole program", "optimizer");
+
+        llvm::internalizeModule(*module, [](const llvm::GlobalValue& value){
+            return value.getName() == "main";
+        });
+
+        llvm::legacy::PassManager whole_program_passes;
+        whole_program_passes.add(llvm::createIPSCCPPass());
+        whole_program_passes.add(llvm::createGlobalDCEPass());
+        whole_program_passes.add(llvm::createDeadArgEliminationPass());
+        whole_program_passes.add(llvm::createPostOrderFunctionAttrsLegacyPass());
+        whole_program_passes.add(llvm::createReversePostOrderFunctionAttrsPass());
+        whole_program_passes.run(*module);
+    }
+
+    llvm::PassManagerBuilder pipeline;
+    pipeline.OptLevel = level;
+    pipeline.SizeLevel = 0;
+    pipeline.Inliner = llvm::createFunctionInliningPass(level, 0, false);
+    pipeline.LoopVectorize = level > 1;
+    pipeline.SLPVectorize = level > 1;
+
+    llvm::legacy::FunctionPassManager function_passes(module.get());
+    llvm::legacy::PassManager module_passes;
+
+    if (target_machine != nullptr){
+        // Let the passes query the cost model of the host target
+        target_machine->adjustPassManager(pipeline);
+        function_passes.add(llvm::createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+        module_passes.add(llvm::createTargetTransformInfoWrapperPass(target_machine->getTargetIRAnalysis()));
+    }
+
+    pipeline.populateFunctionPassManager(function_passes);
+    pipeline.populateModulePassManager(module_passes);
+
+    function_passes.doInitialization();
+
+    for (auto it = module->begin(); it != module->end(); it++){
+        Span span(it->getName().str(), "function passes");
+        function_passes.run(*it);
+    }
+
+    function_passes.doFinalization();
+
+    Span span("module passes", "optimizer");
+    module_passes.run(*module);
+}
+
+bool CodeGenerator::emit_object(const std::string& file_name){
+
+    if (target_machine == nullptr)
+        return false;
+
+    std::error_code error;
+    llvm::raw_fd_ostream output(file_name, error, llvm::sys::fs::OF_None);
+
+    if (error)
+        return false;
+
+    llvm::legacy::PassManager backend;
+
+    // addPassesToEmitFile returns true when the target cannot emit this kind of file
+    if (target_machine->addPassesToEmitFile(backend, output, nullptr, llvm::TargetMachine::CGFT_ObjectFile))
+        return false;
+
+    backend.run(*module);
+    output.flush();
+
+    return true;
+}
+
+/**
+ * Prints the errors of the JIT with the errors of the file being compiled
+ */
+static void log_errors(llvm::Error error){
+    llvm::raw_os_ostream errors(*diagnostics);
+    llvm::logAllUnhandledErrors(std::move(error), errors, "vsopc: ");
+}
+
+bool CodeGenerator::run(int& exit_code){
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+
+    if (!jit){
+        log_errors(jit.takeError());
+        return false;
+    }
+
+    llvm::orc::JITDylib& dylib = (*jit)->getMainJITDylib();
+    llvm::orc::MangleAndInterner mangle((*jit)->getExecutionSession(), (*jit)->getDataLayout());
+
+    // Map the runtime functions to their address inside vsopc
+    llvm::orc::SymbolMap runtime;
+
+    for (auto& it : runtime_symbols)
+        runtime[mangle(it.first)] = llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(it.second), llvm::JITSymbolFlags::Exported);
+
+    if (auto error = dylib.define(llvm::orc::absoluteSymbols(runtime))){
+        log_errors(std::move(error));
+        return false;
+    }
+
+    // The C library (malloc, strcmp, printf, ...) is looked up in the process itself
+    auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess((*jit)->getDataLayout().getGlobalPrefix());
+
+    if (!process){
+        log_errors(process.takeError());
+        return false;
+    }
+
+    dylib.setGenerator(std::move(*process));
+
+    // The builder refers to the context, which now belongs to the JIT
+    builder.reset();
+    module->setDataLayout((*jit)->getDataLayout());
+
+    if (auto error = (*jit)->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))){
+        log_errors(std::move(error));
+        return false;
+    }
+
+    auto main = (*jit)->lookup("main");
+
+    if (!main){
+        log_errors(main.takeError());
+        return false;
+    }
 
-    optimizer.add(llvm::createInstructionCombiningPass());
-    optimizer.add(llvm::createReassociatePass());
-    optimizer.add(llvm::createGVNPass());
-    optimizer.add(llvm::createCFGSimplificationPass());
+    auto entry_point = (int (*)()) main->getAddress();
+    exit_code = entry_point();
 
-    optimizer.doInitialization();
+    // The output of the runtime must be visible before the JIT goes away
+    fflush(stdout);
 
-    for (auto it = module->begin(); it != module->end(); it++)
-        optimizer.run(*it);
-    
+    return true;
 }
\ No newline at end of file
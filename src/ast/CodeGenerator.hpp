@@ -6,6 +6,8 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
+#include <algorithm>
 
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Module.h"
@@ -17,12 +19,35 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/Support/raw_ostream.h"
-#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/FunctionAttrs.h"
+#include "llvm/Transforms/IPO/Internalize.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Scalar.h"
-#include "llvm/Transforms/Scalar/GVN.h"
+#include "SymbolTable.hpp"
+#include "Profiler.hpp"
 
 /**
  * Determines if a type is int32
@@ -70,13 +95,13 @@ bool is__class(llvm::Type* type);
 bool is_unit(llvm::Type* type);
 
 /**
- * Converts a llvm Type to string
+ * Converts a llvm Type to the name of its VSOP type
  * 
  * @param type The llvm Type
  * 
- * @returns A string representation of the type
+ * @returns The Symbol of the type
  */
-std::string type_to_string(llvm::Type* type);
+Symbol type_to_symbol(llvm::Type* type);
 
 /**
  * Checks if two types are the same
@@ -92,10 +117,20 @@ class CodeGenerator {
 
     public: 
 
-            std::shared_ptr<llvm::LLVMContext> context;
+            std::unique_ptr<llvm::LLVMContext> context;    // Owned, so that the module can be handed to the JIT
             std::shared_ptr<llvm::IRBuilder<>> builder;
-            std::shared_ptr<llvm::Module> module;
-            std::unordered_map<std::string, std::vector<llvm::Value*>> scope;
+            std::unique_ptr<llvm::Module> module;
+            ScopedEnvironment<llvm::Value*> scope;
+            std::shared_ptr<llvm::TargetMachine> target_machine;
+            bool bump_alloc = false;    // Objects come from the runtime allocator (runtime/alloc.c) instead of malloc
+            bool inline_alloc = true;   // Inline the fast path of the allocator, which reads thread-local variables
+            bool gc = false;    // Objects are owned by the garbage collector (runtime/gc.c) and rooted on the shadow stack
+            bool whole_program = false; // The module is the whole program: only main is used from outside
+            std::unordered_map<std::string, llvm::Constant*> string_pool;   // Pointer to the global of each string literal, by content
+            llvm::Function* frame = nullptr;    // Function whose stack slots are planned
+            std::unordered_map<llvm::Type*, std::vector<llvm::AllocaInst*>> free_slots;   // Slots of frame that are not used anymore, by type
+            std::vector<llvm::AllocaInst*> temporary_roots;    // Roots of frame holding the temporaries still in use, the innermost last
+            std::vector<llvm::AllocaInst*> free_roots;         // Roots of frame whose temporary is dead
 
             /**
              * Create a new CodeGenerator object
@@ -113,7 +148,7 @@ class CodeGenerator {
              * @param var The name of the variable
              * @param value The llvm value of the variable
              */
-            void insert(const std::string& var, llvm::Value* val);
+            void insert(Symbol var, llvm::Value* val);
 
             /**
              * Remove a name inside the symbol table,
@@ -121,7 +156,15 @@ class CodeGenerator {
              * @param var The name of the variable
              * @param value The llvm value of the variable
              */
-            void remove(const std::string& var);
+            void remove(Symbol var);
+
+            /**
+             * Remove a name inside the symbol table, and give its slot
+             * back so that a later variable of the same type reuses it
+             * 
+             * @param var The name of the variable
+             */
+            void release(Symbol var);
 
             /**
              * Determines wheter a variable is in the symbol table.
@@ -130,7 +173,7 @@ class CodeGenerator {
              * 
              * @returns true if the var is inside the symbol table, false else.
              */
-            bool look_up(const std::string& var);
+            bool look_up(Symbol var);
 
             /**
              * Returns the value of a variable
@@ -139,7 +182,7 @@ class CodeGenerator {
              * 
              * @returns The value of var
              */
-            llvm::Value* get_val(const std::string& var);
+            llvm::Value* get_val(Symbol var);
 
             /**
              * Returns the type of a variable
@@ -148,7 +191,18 @@ class CodeGenerator {
              * 
              * @returns The type of var
              */
-            llvm::Type* get_type(const std::string& var);
+            llvm::Type* get_type(Symbol var);
+
+            /**
+             * Get a stack slot of the current function, in its entry block
+             * so that it is allocated once even inside a loop. The slots
+             * released by the variables whose scope is over are reused.
+             * 
+             * @param type The type of the value stored in the slot
+             * 
+             * @returns The slot
+             */
+            llvm::AllocaInst* create_slot(llvm::Type* type);
 
             /**
              * Inserts a new name inside the symbol table and
@@ -157,7 +211,7 @@ class CodeGenerator {
              * @param var The name of the variable
              * @param type The llvm type of the variable
              */
-            void allocate(const std::string& var, llvm::Type* type);
+            void allocate(Symbol var, llvm::Type* type);
 
             /**
              * Stores a variable in memory
@@ -165,7 +219,7 @@ class CodeGenerator {
              * @param var The name of the variable
              * @param val The llvm value of the variable
              */
-            void store(const std::string& var, llvm::Value* val);
+            void store(Symbol var, llvm::Value* val);
 
             /**
              * Load a variable from memory
@@ -174,16 +228,16 @@ class CodeGenerator {
              * 
              * @returns The llvm value of the variable
              */
-            llvm::Value* load(const std::string &var);
+            llvm::Value* load(Symbol var);
 
             /**
-             * Converts a string to a llvm type
+             * Converts a type name to a llvm type
              * 
-             * @param type The string representing the type
+             * @param type The name of the type
              * 
              * @returns a llvm Type corresponding to the type
              */
-            llvm::Type* to_type(const std::string& type);
+            llvm::Type* to_type(Symbol type);
 
             /**
              * Get the default value of a llvm Type
@@ -195,13 +249,13 @@ class CodeGenerator {
             llvm::Value* default_val(llvm::Type* type);
 
             /**
-             * Get the default value of a string type
+             * Get the default value of a named type
              * 
-             * @param type The type (in string)
+             * @param type The name of the type
              * 
              * @returns The default value of the type
              */
-            llvm::Value* default_val(const std::string& type);
+            llvm::Value* default_val(Symbol type);
 
             /**
              * Get the string representation of the llvm code
@@ -212,12 +266,157 @@ class CodeGenerator {
             std::string print();
 
             /**
-             * Performs the following optimization passes:
-             * "peephole" optimizations, reassociate expressions,
-             * eliminate common subexpressions, simplify the control
-             * flow graph (delete unreachable blocks, ...).
+             * Emits the allocation of the memory of an object at the
+             * current insertion point. With the bump allocator, objects
+             * small enough to come from a region are allocated inline,
+             * and the runtime is only called when the region is full.
+             * With the garbage collector, the memory is zeroed.
+             * 
+             * @param size The size of the object, known statically
+             * @param map The pointer map of the class (gc only), nullptr if it has no pointer
+             * 
+             * @returns The i8* pointer to the memory, null if it failed
+             */
+            llvm::Value* create_alloc(uint64_t size, llvm::Constant* map = nullptr);
+
+            /**
+             * Get a pointer to a constant string, emitting its global the
+             * first time the content is seen. Equal literals share the
+             * same private global.
+             * 
+             * @param text The content of the string
+             * 
+             * @returns The i8* constant pointing to the string
+             */
+            llvm::Constant* string_constant(const std::string& text);
+
+            /**
+             * Emits the integer power of a base by an exponent, with the
+             * int32 arithmetic wrapping around. A constant exponent is
+             * unrolled into multiplications, a power of two as base becomes
+             * a shift, and the other cases call an exponentiation by
+             * squaring helper. A negative exponent gives the integer part
+             * of the exact result, as with the former lowering through
+             * llvm.powi.f64.
+             * 
+             * @param base The base, an int32
+             * @param exponent The exponent, an int32
+             * 
+             * @returns The int32 result
+             */
+            llvm::Value* create_pow(llvm::Value* base, llvm::Value* exponent);
+
+            /**
+             * Allocates an object in the frame of the current function,
+             * in its entry block so that a loop reuses the same memory.
+             * It must not outlive the call of the function.
+             * 
+             * @param type The structure of the class
+             * 
+             * @returns The pointer to the object, not initialized
+             */
+            llvm::AllocaInst* create_stack_object(llvm::StructType* type);
+
+            /**
+             * Creates a stack slot that the garbage collector scans, in the
+             * entry block of the current function. It starts as null.
+             * 
+             * @param type The type of the slot, a pointer to a class
+             * 
+             * @returns The slot
+             */
+            llvm::AllocaInst* create_root(llvm::Type* type);
+
+            /**
+             * Keeps a temporary object alive until the roots are released,
+             * when the garbage collector is used. The arguments, rooted by
+             * the caller, and the constants are not stored. The loads are,
+             * as their variable or field may be assigned in the meantime.
+             * 
+             * @param value The value, which is only rooted if it is an object
+             */
+            void root(llvm::Value* value);
+
+            /**
+             * Marks the temporary roots in use before an expression
+             * 
+             * @returns The mark, to give to release_roots
+             */
+            size_t root_mark();
+
+            /**
+             * Releases the temporary roots taken since a mark, whose slots
+             * are reused by the next temporaries of the function
+             * 
+             * @param mark The mark taken before the expression
+             */
+            void release_roots(size_t mark);
+
+            /**
+             * Forgets the slots and the roots planned for the previous
+             * function, when the code of another function is generated
+             */
+            void enter_frame();
+
+            /**
+             * Links the runtime, compiled to bitcode, inside the module so
+             * that the optimizer can inline it. In whole program mode,
+             * everything but main is then made internal.
+             * 
+             * @param file_name The path of the bitcode of the runtime
+             * 
+             * @returns true if the runtime has been linked, false else
+             */
+            bool link_runtime(const std::string& file_name);
+
+            /**
+             * Reads the bitcode of the runtime, only the first time it is
+             * asked for: the following compilations of the process (a
+             * server, a batch) parse it from memory.
+             * 
+             * @param file_name The path of the bitcode of the runtime
+             * 
+             * @returns The bitcode, nullptr if it cannot be read
+             */
+            static const llvm::MemoryBuffer* load_runtime(const std::string& file_name);
+
+            /**
+             * Runs the standard LLVM pipeline for the given level on the
+             * whole module. From -O1 on, this promotes the stack slots of
+             * the variables to registers (mem2reg/SROA), inlines, hoists
+             * loop invariants and runs the loop and interprocedural
+             * (IPSCCP, ...) passes. The level is also used by the backend.
+             * In whole program mode, everything but main is made internal
+             * first, then the unused functions and globals are deleted, the
+             * unused arguments are removed and the attributes of the
+             * functions are inferred, before the standard pipeline.
+             * 
+             * @param level The optimization level, from 0 to 3
+             */
+            void optimizer(unsigned level = 2);
+
+            /**
+             * Emits the object file of the module for the host target,
+             * directly from the in-memory module.
+             * 
+             * @param file_name The path of the object file to write
+             * 
+             * @returns true if the object file has been written, false else
+             */
+            bool emit_object(const std::string& file_name);
+
+            /**
+             * Compiles the module with an ORC JIT and calls its main
+             * function. The runtime (object.s) is linked inside vsopc,
+             * so its symbols are resolved in-process. The module and the
+             * context are given to the JIT: the CodeGenerator cannot be
+             * used anymore afterwards.
+             * 
+             * @param exit_code Set to the value returned by main
+             * 
+             * @returns true if main has been executed, false else
              */
-            void optimizer();
+            bool run(int& exit_code);
 };
 
 #endif
\ No newline at end of file
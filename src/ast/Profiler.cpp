@@ -0,0 +1,162 @@
+#include "Profiler.hpp"
+#include <fstream>
+#include <iomanip>
+#include <sys/resource.h>
+
+using namespace std;
+
+Profiler profiler;
+
+static long cpu_time(const struct rusage& usage){
+
+    // The children (the linker) are counted once they have been waited for, whatever the thread
+    struct rusage children;
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + children.ru_utime.tv_sec + children.ru_stime.tv_sec) * 1000000L
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec + children.ru_utime.tv_usec + children.ru_stime.tv_usec;
+}
+
+static string escape_json(const string& text){
+
+    string escaped;
+
+    for (char c : text){
+        if (c == '"' || c == '\\'){
+            escaped += '\\';
+            escaped += c;
+        }else if ((unsigned char) c < 0x20){
+            escaped += ' ';
+        }else{
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// Profiler class
+
+Profiler::Profiler(): origin(chrono::steady_clock::now()) {}
+
+Profiler::~Profiler(){
+
+    // Spans that are still open (early exit) end now
+    for (auto& thread : threads)
+        while (!thread.second.open.empty())
+            close(thread.second);
+
+    if (time_report)
+        report(cerr);
+
+    if (!trace_file.empty() && !write_trace(trace_file))
+        cerr << "vsopc: cannot write trace file " << trace_file << endl;
+}
+
+void Profiler::begin(const string& name, const char* category){
+
+    // Only the CPU time of the calling thread, the other jobs of a batch run meanwhile
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    long start = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - origin).count();
+
+    lock_guard<mutex> guard(lock);
+
+    auto it = threads.find(this_thread::get_id());
+
+    if (it == threads.end())
+        it = threads.insert({this_thread::get_id(), {(int) threads.size() + 1, {}}}).first;
+
+    it->second.open.push_back({events.size(), cpu_time(usage)});
+    events.push_back({name, category, start, 0, 0, 0, it->second.number});
+}
+
+void Profiler::end(){
+
+    lock_guard<mutex> guard(lock);
+
+    auto it = threads.find(this_thread::get_id());
+
+    if (it == threads.end() || it->second.open.empty())
+        return;
+
+    close(it->second);
+}
+
+void Profiler::close(Thread& thread){
+
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    Event& event = events[thread.open.back().event];
+    long now = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - origin).count();
+
+    event.duration = now - event.start;
+    event.cpu = cpu_time(usage) - thread.open.back().cpu;
+    event.peak_rss = usage.ru_maxrss;   // Already in kilobytes on Linux, for the whole process
+
+    thread.open.pop_back();
+}
+
+void Profiler::report(ostream& output){
+
+    long total_wall = 0, total_cpu = 0, peak_rss = 0;
+
+    output << "===-------------------------------------------------------------===" << endl;
+    output << "                     vsopc time report" << endl;
+    output << "===-------------------------------------------------------------===" << endl;
+    output << left << setw(16) << "phase" << right << setw(14) << "wall (ms)" << setw(14) << "cpu (ms)" << setw(18) << "peak rss (MB)" << endl;
+
+    output << fixed << setprecision(3);
+
+    for (auto& event : events){
+
+        // Only the phases of the compiler, not the spans nested inside them
+        if (string(event.category) != "phase")
+            continue;
+
+        output << left << setw(16) << event.name << right
+               << setw(14) << event.duration / 1000.0
+               << setw(14) << event.cpu / 1000.0
+               << setw(18) << event.peak_rss / 1024.0 << endl;
+
+        total_wall += event.duration;
+        total_cpu += event.cpu;
+        peak_rss = max(peak_rss, event.peak_rss);
+    }
+
+    output << left << setw(16) << "total" << right
+           << setw(14) << total_wall / 1000.0
+           << setw(14) << total_cpu / 1000.0
+           << setw(18) << peak_rss / 1024.0 << endl;
+
+    output.unsetf(ios::floatfield);
+}
+
+bool Profiler::write_trace(const string& file_name){
+
+    ofstream output(file_name);
+
+    if (!output)
+        return false;
+
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    for (size_t i = 0; i < events.size(); i++){
+
+        const Event& event = events[i];
+
+        // Complete events ("X"), nested by the viewer from their start and duration
+        output << (i == 0 ? "" : ",") << "\n{\"name\":\"" << escape_json(event.name)
+               << "\",\"cat\":\"" << event.category
+               << "\",\"ph\":\"X\",\"ts\":" << event.start
+               << ",\"dur\":" << event.duration
+               << ",\"pid\":1,\"tid\":" << event.thread << ",\"args\":{\"cpu_us\":" << event.cpu
+               << ",\"peak_rss_kb\":" << event.peak_rss << "}}";
+    }
+
+    output << "\n]}" << endl;
+
+    return output.good();
+}
\ No newline at end of file
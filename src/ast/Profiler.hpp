@@ -0,0 +1,141 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * This class measures where the compiler spends its time.
+ *
+ * It records spans (a phase of the compiler, the code generation of a
+ * class or of a method, ...) which can be summed up in a report of the
+ * phases, and dumped as a Chrome trace (chrome://tracing, Perfetto).
+ * Nothing is recorded while neither output is asked for. The spans of
+ * the threads of a batch are recorded side by side.
+ */
+class Profiler{
+
+    public:
+
+            struct Event{
+                std::string name;
+                const char* category;
+                long start;         // Wall time since the creation of the Profiler, in microseconds
+                long duration;      // Wall time, in microseconds
+                long cpu;           // User + system time, in microseconds
+                long peak_rss;      // Peak resident set size at the end of the span, in kilobytes
+                int thread;         // Number of the thread, in the order they opened their first span
+            };
+
+            bool time_report = false;   // Print the time spent in each phase
+            std::string trace_file;     // Chrome trace file, empty if not asked for
+            std::vector<Event> events;
+
+            Profiler();
+
+            /**
+             * Writes the report and the trace that have been asked for
+             */
+            ~Profiler();
+
+            /**
+             * Determines whether the spans are recorded
+             *
+             * @returns true if a report or a trace is asked for, false else
+             */
+            bool enabled() const{
+                return time_report || !trace_file.empty();
+            }
+
+            /**
+             * Opens a new span, nested in the spans that are still open
+             *
+             * @param name The name of the span
+             * @param category The kind of span, "phase" for the phases of the compiler
+             */
+            void begin(const std::string& name, const char* category);
+
+            /**
+             * Closes the last span that has been opened by the calling thread
+             */
+            void end();
+
+            /**
+             * Prints the wall time, the CPU time and the peak RSS of each phase
+             *
+             * @param output The stream where the report is written
+             */
+            void report(std::ostream& output);
+
+            /**
+             * Writes all the spans in the Chrome trace event format
+             *
+             * @param file_name The file where the trace is written
+             *
+             * @returns true if the trace has been written, false else
+             */
+            bool write_trace(const std::string& file_name);
+
+    private:
+
+            struct Open{
+                size_t event;       // Index in events
+                long cpu;           // CPU time at the start of the span
+            };
+
+            struct Thread{
+                int number;
+                std::vector<Open> open;     // Spans still open, the innermost last
+            };
+
+            std::chrono::steady_clock::time_point origin;
+            std::unordered_map<std::thread::id, Thread> threads;
+            std::mutex lock;
+
+            /**
+             * Closes the innermost span still open in a thread
+             *
+             * @param thread The thread, whose lock is already held
+             */
+            void close(Thread& thread);
+};
+
+extern Profiler profiler;
+
+/**
+ * Span which lasts as long as the C++ scope where it is declared.
+ */
+class Span{
+
+    public:
+
+            /**
+             * Opens a span in the global profiler, if it is enabled
+             *
+             * @param name The name of the span
+             * @param category The kind of span
+             */
+            Span(const std::string& name, const char* category): active(profiler.enabled()){
+                if (active)
+                    profiler.begin(name, category);
+            }
+
+            Span(const Span&) = delete;
+            Span& operator=(const Span&) = delete;
+
+            ~Span(){
+                if (active)
+                    profiler.end();
+            }
+
+    private:
+
+            bool active;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,280 @@
+#include "Server.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <csignal>
+#include <climits>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/*
+ * Every message is a sequence of 32-bit numbers and of strings, each
+ * string being preceded by its length.
+ *
+ * Request: number of strings, working directory, arguments...
+ * Answer: exit code, output, diagnostics
+ *
+ * The lengths come from the other side of the socket, so they are bounded
+ * before anything is allocated.
+ */
+
+static const int32_t MAX_ARGUMENT = 1 << 20;        // Length of a string of a request
+static const int32_t MAX_ARGUMENTS = 4096;          // Number of strings of a request
+static const int32_t MAX_REQUEST = 16 << 20;        // Length of all the strings of a request
+static const int32_t MAX_ANSWER = INT32_MAX;        // Length of a string of an answer, the client trusts its server
+static const int RECEIVE_TIMEOUT = 5;               // Seconds a client may take to send its request
+static const size_t MAX_PENDING = 64;               // Clients accepted but not answered yet, per worker
+
+static bool write_all(int fd, const char* data, size_t length){
+
+    while (length > 0){
+
+        ssize_t written = write(fd, data, length);
+
+        if (written <= 0)
+            return false;
+
+        data += written;
+        length -= written;
+    }
+
+    return true;
+}
+
+static bool read_all(int fd, char* data, size_t length){
+
+    while (length > 0){
+
+        ssize_t nb_read = read(fd, data, length);
+
+        if (nb_read <= 0)
+            return false;
+
+        data += nb_read;
+        length -= nb_read;
+    }
+
+    return true;
+}
+
+static bool write_number(int fd, int32_t number){
+    return write_all(fd, (const char*) &number, sizeof(number));
+}
+
+static bool read_number(int fd, int32_t& number){
+    return read_all(fd, (char*) &number, sizeof(number));
+}
+
+static bool write_string(int fd, const string& text){
+    return write_number(fd, text.size()) && write_all(fd, text.data(), text.size());
+}
+
+/**
+ * Reads a string preceded by its length
+ *
+ * @param fd The socket
+ * @param text Receives the string
+ * @param max_length The longest string accepted
+ *
+ * @returns true if the string has been read, false else or if it is too long
+ */
+static bool read_string(int fd, string& text, int32_t max_length){
+
+    int32_t length;
+
+    if (!read_number(fd, length) || length < 0 || length > max_length)
+        return false;
+
+    text.resize(length);
+
+    return read_all(fd, &text[0], length);
+}
+
+static bool socket_address(const string& socket_path, struct sockaddr_un& address){
+
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return false;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path.c_str());
+
+    return true;
+}
+
+/**
+ * Reads one request from a client, compiles it and sends back the results
+ *
+ * @param client The socket of the client, closed at the end
+ * @param handler The function which compiles the request
+ */
+static void answer(int client, const server::Handler& handler){
+
+    int32_t nb_strings;
+    int64_t total = 0;
+    string directory;
+    vector<string> args;
+
+    bool received = read_number(client, nb_strings) && nb_strings > 0 && nb_strings <= MAX_ARGUMENTS
+                 && read_string(client, directory, MAX_ARGUMENT);
+
+    for (int32_t i = 1; received && i < nb_strings && total <= MAX_REQUEST; i++){
+        args.emplace_back();
+        received = read_string(client, args.back(), MAX_ARGUMENT);
+        total += args.back().size();
+    }
+
+    if (received && total <= MAX_REQUEST){
+        ostringstream output, errors;
+        int exit_code = handler(args, directory, output, errors);
+
+        write_number(client, exit_code) && write_string(client, output.str()) && write_string(client, errors.str());
+    }
+
+    close(client);
+}
+
+/**
+ * Clients accepted by the server, waiting for a worker
+ */
+struct Queue{
+
+    deque<int> clients;
+    size_t capacity;
+    mutex lock;
+    condition_variable not_empty;
+    condition_variable not_full;
+
+    Queue(size_t capacity): capacity(capacity) {}
+
+    void push(int client){
+        unique_lock<mutex> guard(lock);
+
+        // The next clients wait in the backlog of the socket
+        not_full.wait(guard, [this](){ return clients.size() < capacity; });
+        clients.push_back(client);
+        not_empty.notify_one();
+    }
+
+    int pop(){
+        unique_lock<mutex> guard(lock);
+
+        not_empty.wait(guard, [this](){ return !clients.empty(); });
+        int client = clients.front();
+        clients.pop_front();
+        not_full.notify_one();
+
+        return client;
+    }
+};
+
+// Server
+
+int server::serve(const string& socket_path, const Handler& handler){
+
+    struct sockaddr_un address;
+
+    if (!socket_address(socket_path, address)){
+        cerr << "vsopc: socket path too long " << socket_path << endl;
+        return 1;
+    }
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    // A socket left by a server that has been stopped is replaced
+    unlink(socket_path.c_str());
+
+    // Only the user of the server may connect: a request reads, writes and links files as this user.
+    // The mask is set around bind, so the socket is never open to the others (no thread runs yet)
+    mode_t mask = umask(0077);
+    bool bound = listener >= 0 && bind(listener, (struct sockaddr*) &address, sizeof(address)) == 0;
+    umask(mask);
+
+    if (!bound || listen(listener, SOMAXCONN) != 0){
+        cerr << "vsopc: cannot listen on " << socket_path << endl;
+        return 1;
+    }
+
+    // A client which leaves before its answer must not stop the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // One worker per core, each request being compiled on one thread
+    size_t nb_workers = max(1u, thread::hardware_concurrency());
+    Queue queue(MAX_PENDING * nb_workers);
+
+    for (size_t i = 0; i < nb_workers; i++)
+        thread([&queue, &handler](){
+            for (;;)
+                answer(queue.pop(), handler);
+        }).detach();
+
+    // A client which does not send its request must not hold a worker forever
+    struct timeval timeout = {RECEIVE_TIMEOUT, 0};
+
+    for (;;){
+
+        int client = accept(listener, nullptr, nullptr);
+
+        if (client < 0){
+            // Out of descriptors: wait for the workers to close some instead of spinning
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM)
+                usleep(100000);
+
+            continue;
+        }
+
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        queue.push(client);
+    }
+}
+
+bool server::forward(const string& socket_path, const vector<string>& args, int& exit_code){
+
+    struct sockaddr_un address;
+
+    if (!socket_address(socket_path, address))
+        return false;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0)
+        return false;
+
+    if (connect(fd, (struct sockaddr*) &address, sizeof(address)) != 0){
+        close(fd);
+        return false;
+    }
+
+    char directory[PATH_MAX];
+    bool sent = getcwd(directory, sizeof(directory)) != nullptr
+             && write_number(fd, args.size() + 1) && write_string(fd, directory);
+
+    for (size_t i = 0; sent && i < args.size(); i++)
+        sent = write_string(fd, args[i]);
+
+    int32_t code;
+    string output, errors;
+    bool answered = sent && read_number(fd, code) && read_string(fd, output, MAX_ANSWER) && read_string(fd, errors, MAX_ANSWER);
+
+    close(fd);
+
+    if (!answered)
+        return false;
+
+    cout << output << flush;
+    cerr << errors << flush;
+    exit_code = code;
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Compile server, which keeps a vsopc process alive between the
+ * compilations so that they do not pay its start up again.
+ *
+ * A client sends the arguments of its command line and its working
+ * directory on a Unix socket. The server compiles it on one of a fixed
+ * number of worker threads, and sends back the exit code, the output and
+ * the diagnostics. A request that is too large, or that is not received
+ * within a few seconds, is dropped.
+ * The files are read and written by the server at the paths of the client,
+ * so only the user of the server can connect to the socket.
+ */
+namespace server{
+
+    /**
+     * Compiles a request, and writes its results in the given streams
+     *
+     * @param args The arguments of the command line of the client
+     * @param directory The working directory of the client
+     * @param output The stream of the results (-p, -c, -i, -lex)
+     * @param errors The stream of the diagnostics
+     *
+     * @returns The exit code of the request
+     */
+    typedef std::function<int(const std::vector<std::string>& args, const std::string& directory,
+                              std::ostream& output, std::ostream& errors)> Handler;
+
+    /**
+     * Serves the requests until the process is stopped
+     *
+     * @param socket_path The path of the Unix socket, replaced if it exists
+     * @param handler The function which compiles each request
+     *
+     * @returns 1 if the socket cannot be opened, never returns else
+     */
+    int serve(const std::string& socket_path, const Handler& handler);
+
+    /**
+     * Sends a command line to a server, and writes its results on the
+     * standard output and error of the client
+     *
+     * @param socket_path The path of the Unix socket of the server
+     * @param args The arguments of the command line
+     * @param exit_code Receives the exit code of the request
+     *
+     * @returns true if the server has answered, false if it cannot be reached
+     */
+    bool forward(const std::string& socket_path, const std::vector<std::string>& args, int& exit_code);
+}
+
+#endif
\ No newline at end of file
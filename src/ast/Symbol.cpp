@@ -0,0 +1,112 @@
+#include "Symbol.hpp"
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * Global table of the interned texts, shared by the threads of a batch.
+ *
+ * The texts are read far more often than new ones are interned, so str()
+ * takes no lock: the table of the texts only grows, by buckets which are
+ * never moved. The number of texts is stored with release after the text,
+ * and str() loads it with acquire, so a reader which loads a size above an
+ * id also sees the text of that id.
+ */
+struct Interner{
+
+    static const unsigned FIRST_BITS = 8;   // The first bucket holds 2^8 texts, each next one twice as many
+
+    unordered_map<string, uint32_t> ids;
+    unique_ptr<const string*[]> buckets[32 - FIRST_BITS + 1];  // Point to the keys of ids, which never move
+    atomic<uint32_t> size{0};
+    shared_timed_mutex lock;        // Only taken to intern, most names are already interned so lookups do not block each other
+
+    Interner(){
+        // Same order as the constants of the symbols namespace
+        for (const char* text : {"", "int32", "bool", "string", "unit", "Object", "self", "unknown", "Main", "main"})
+            intern(text);
+    }
+
+    /**
+     * Finds where a text is stored
+     *
+     * @param id The id of the text
+     * @param bucket Set to the index of its bucket
+     *
+     * @returns The index of the text in its bucket
+     */
+    static uint64_t locate(uint32_t id, unsigned& bucket){
+
+        uint64_t position = (uint64_t) id + (1 << FIRST_BITS);
+        unsigned bits = 63 - __builtin_clzll(position);
+
+        bucket = bits - FIRST_BITS;
+
+        return position - ((uint64_t) 1 << bits);
+    }
+
+    uint32_t intern(const string& text){
+
+        {
+            shared_lock<shared_timed_mutex> reader(lock);
+            auto it = ids.find(text);
+
+            if (it != ids.end())
+                return it->second;
+        }
+
+        unique_lock<shared_timed_mutex> writer(lock);
+
+        // Another thread may have interned it in the meantime
+        auto it = ids.insert({text, size.load(memory_order_relaxed)});
+
+        if (it.second){
+            unsigned bucket;
+            uint64_t index = locate(it.first->second, bucket);
+
+            if (!buckets[bucket])
+                buckets[bucket].reset(new const string*[(uint64_t) 1 << (bucket + FIRST_BITS)]);
+
+            buckets[bucket][index] = &it.first->first;
+
+            // The readers which see the new size also see the text
+            size.store(it.first->second + 1, memory_order_release);
+        }
+
+        return it.first->second;
+    }
+
+    const string& str(uint32_t id){
+
+        // The id was returned by intern before it reached this thread, so the size
+        // loaded is above it, and the store of that size came after the text
+        uint32_t published = size.load(memory_order_acquire);
+        assert(id < published);
+        (void) published;
+
+        unsigned bucket;
+        uint64_t index = locate(id, bucket);
+
+        return *buckets[bucket][index];
+    }
+};
+
+static Interner& interner(){
+    static Interner instance;
+    return instance;
+}
+
+// Symbol class
+
+Symbol Symbol::intern(const string& text){
+    return Symbol(interner().intern(text));
+}
+
+const string& Symbol::str() const{
+    return interner().str(id);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+/**
+ * This class represents an interned name (identifier, type, ...).
+ *
+ * All the symbols with the same text share the same 32-bit id, so that
+ * comparing or hashing two names is an integer operation.
+ */
+class Symbol{
+
+    public:
+
+            uint32_t id;
+
+            Symbol() = default;   // Trivial, so that a Symbol can be stored in the parser union
+
+            /**
+             * Creates a Symbol from its id
+             *
+             * @param id The id of an interned text
+             *
+             * @returns the Symbol with this id
+             */
+            constexpr explicit Symbol(uint32_t id): id(id) {}
+
+            /**
+             * Interns a text
+             *
+             * @param text The text
+             *
+             * @returns the unique Symbol of this text
+             */
+            static Symbol intern(const std::string& text);
+
+            /**
+             * Get the text of the Symbol
+             *
+             * @returns the text which has been interned
+             */
+            const std::string& str() const;
+
+            bool operator==(Symbol other) const { return id == other.id; }
+            bool operator!=(Symbol other) const { return id != other.id; }
+};
+
+/**
+ * Symbols that are interned before everything else, in this order.
+ */
+namespace symbols{
+
+    constexpr Symbol EMPTY(0);
+    constexpr Symbol INT32(1);
+    constexpr Symbol BOOL(2);
+    constexpr Symbol STRING(3);
+    constexpr Symbol UNIT(4);
+    constexpr Symbol OBJECT(5);
+    constexpr Symbol SELF(6);
+    constexpr Symbol UNKNOWN(7);
+    constexpr Symbol MAIN(8);
+    constexpr Symbol MAIN_METHOD(9);
+}
+
+namespace std{
+
+    template <>
+    struct hash<Symbol>{
+        size_t operator()(Symbol symbol) const {
+            return symbol.id;
+        }
+    };
+}
+
+#endif
\ No newline at end of file
@@ -1,52 +1,124 @@
 #ifndef SYMBOLTABLE_HPP
 #define SYMBOLTABLE_HPP
 
-#include <unordered_map>
+#include <cassert>
+#include <cstdint>
 #include <vector>
 #include <string>
+#include "Symbol.hpp"
 
-
-class SymbolTable{
+/**
+ * This class represents nested scopes of names bound to values.
+ *
+ * All the bindings are appended to a single log, and each name only
+ * remembers the index of its innermost binding, which itself remembers
+ * the binding it shadows. Entering a scope is pushing to the log, and
+ * leaving it is popping back to a mark, without any hashing.
+ *
+ * @tparam T The type of the values bound to the names
+ */
+template <typename T>
+class ScopedEnvironment{
 
     public:
-       
-        std::unordered_map<std::string, std::vector<std::string>> symbol_table;
-
-        /**
-         * Inserts a new name inside the symbol table
-         * 
-         * @param var The name of the variable
-         * @param type The type of the variable
-         */
-        void insert(const std::string& var, const std::string& type);
-
-        /**
-         * Remove a name from the symbol table
-         * 
-         * @param var The name of the variable
-         */
-        void remove(const std::string& var);
-
-        /**
-         * Determines wheter a variable is in the symbol table.
-         * 
-         * @param var The name of the variable
-         * 
-         * @returns true if the var is inside the symbol table, false else.
-         */
-        bool look_up(const std::string& var);
-
-        /**
-         * Returns the type of a variable
-         * 
-         * @param var The name of the variable
-         * 
-         * @returns The type of var
-         */
-        std::string get(const std::string& var);
 
+            struct Binding{
+                Symbol name;
+                T value;
+                uint32_t shadowed;  // Position + 1 in the log of the previous binding of name, 0 if none
+            };
+
+            std::vector<Binding> log;
+            std::vector<uint32_t> current;  // Position + 1 in the log of the innermost binding, by symbol id
+
+            /**
+             * Inserts a new name inside the scope, shadowing
+             * its previous binding
+             *
+             * @param var The name of the variable
+             * @param value The value bound to the variable
+             */
+            void insert(Symbol var, const T& value){
+
+                if (var.id >= current.size())
+                    current.resize(var.id + 1, 0);
+
+                log.push_back({var, value, current[var.id]});
+                current[var.id] = log.size();
+            }
+
+            /**
+             * Remove the innermost binding of a name, which must be
+             * the last binding inserted and not removed yet
+             *
+             * @param var The name of the variable
+             */
+            void remove(Symbol var){
+
+                if (!look_up(var))
+                    return;
+
+                uint32_t position = current[var.id];
 
+                // Out of order, the binding would stay in the log and restore would undo it twice
+                assert(position == log.size());
+
+                current[var.id] = log[position - 1].shadowed;
+                log.pop_back();
+            }
+
+            /**
+             * Determines wheter a variable is in the scope.
+             *
+             * @param var The name of the variable
+             *
+             * @returns true if the var is inside the scope, false else.
+             */
+            bool look_up(Symbol var) const{
+                return var.id < current.size() && current[var.id] != 0;
+            }
+
+            /**
+             * Returns the value of a variable
+             *
+             * @param var The name of the variable
+             *
+             * @returns The value bound to var
+             */
+            const T& get(Symbol var) const{
+                return log[current[var.id] - 1].value;
+            }
+
+            /**
+             * Remembers the current state of the scope
+             *
+             * @returns A mark that can be given to restore
+             */
+            size_t mark() const{
+                return log.size();
+            }
+
+            /**
+             * Removes all the bindings inserted since a mark,
+             * in reverse order
+             *
+             * @param mark The mark returned by mark()
+             */
+            void restore(size_t mark){
+
+                while (log.size() > mark){
+
+                    const Binding& binding = log.back();
+                    current[binding.name.id] = binding.shadowed;
+                    log.pop_back();
+                }
+            }
 };
 
+/**
+ * Scope of the semantic analysis, which binds names to their type.
+ */
+typedef ScopedEnvironment<Symbol> SymbolTable;
+
 
 #endif
\ No newline at end of file
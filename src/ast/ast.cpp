@@ -1,6 +1,7 @@
 #include "ast.hpp"
 #include <sstream>
 #include <iomanip>
+#include <cstring>
 
 using namespace std;
 
@@ -9,12 +10,12 @@ using namespace std;
 
 // Utils
 
-bool is_primitive(const string& var){
+bool is_primitive(Symbol var){
 
-    return var == "int32" || var == "bool" || var == "string" || var == "unit";
+    return var == symbols::INT32 || var == symbols::BOOL || var == symbols::STRING || var == symbols::UNIT;
 }
 
-bool _is_class(const string& var, VSOPProgram& prog){
+bool _is_class(Symbol var, VSOPProgram& prog){
 
     if(prog.class_table.find(var) == prog.class_table.end())
         return false;
@@ -22,40 +23,116 @@ bool _is_class(const string& var, VSOPProgram& prog){
         return true;
 }
 
-bool inherits_from(VSOPProgram& prog, const std::string& type_1, const std::string& type_2){
+bool inherits_from(VSOPProgram& prog, Symbol type_1, Symbol type_2){
 
-    if (!_is_class(type_1, prog)){
+    if (type_1 == type_2)
+        return true;
 
-        if (type_1 == type_2)
-            return true;
-        else
-            return false;
+    auto _class_1 = prog.class_table.find(type_1);
+    auto _class_2 = prog.class_table.find(type_2);
 
-    }else{
+    if (_class_1 == prog.class_table.end() || _class_2 == prog.class_table.end())
+        return false;
+
+    return _class_1->second->is_subclass_of(_class_2->second);
+}
+
+Symbol common_parent(VSOPProgram& prog, Symbol type_1, Symbol type_2){
+
+    auto _class_1 = prog.class_table[type_1];
+    auto _class_2 = prog.class_table[type_2];
+
+    if (_class_2->is_subclass_of(_class_1))
+        return _class_1->name;
+
+    if (_class_1->is_subclass_of(_class_2))
+        return _class_2->name;
+
+    // Climb from _class_1 to the highest ancestor that is not an ancestor of _class_2
+    for (size_t k = _class_1->ancestors.size(); k-- > 0;)
+        if (k < _class_1->ancestors.size() && !_class_2->is_subclass_of(_class_1->ancestors[k]))
+            _class_1 = _class_1->ancestors[k];
+
+    return _class_1->ancestors[0]->name;
+}
+
+/**
+ * Determines whether self escapes from one of the methods that a call can reach.
+ * During the escape analysis, the method being analyzed is recorded as a caller
+ * of the methods whose result is read, so that it is analyzed again if they change.
+ */
+static bool receiver_escapes(VSOPProgram& prog, Symbol type, Symbol name, bool value_escapes){
+
+    Class* _class = prog.class_table[type];
+    Method* target = _class->unique_target(name);
+
+    auto escapes = [&prog, value_escapes](Method* method){
+        if (prog.escape_method != nullptr)
+            prog.escape_callers[method].insert(prog.escape_method);
+
+        return method->self_escapes || (method->returns_self && value_escapes);
+    };
+
+    if (target != nullptr)
+        return escapes(target);
+
+    // Otherwise any redefinition of the method below the class may be called
+    std::vector<Class*> below = {_class};
+
+    while (!below.empty()){
 
-        for(auto _class = prog.class_table[type_1]; _class != nullptr; _class = _class->parent_class)
-            if (_class->name == type_2)
-                return true;
+        Class* it = below.back();
+        below.pop_back();
 
-        if (type_1 == type_2)
+        auto _method = it->method_table.find(name);
+
+        if (_method != it->method_table.end() && escapes(_method->second))
             return true;
-        else   
-            return false;
+
+        below.insert(below.end(), it->children.begin(), it->children.end());
     }
+
+    return false;
 }
 
-string common_parent(VSOPProgram& prog, const std::string& type_1, const std::string& type_2){
+static Expr* make_integer(VSOPProgram& prog, int32_t value){
+    Expr* integer = prog.arena.make<Integer>(value);
+    integer->_type = symbols::INT32;
+    return integer;
+}
 
-    auto _class_1 = prog.class_table[type_1];
-    auto _class_2 = prog.class_table[type_2];
+static Expr* make_boolean(VSOPProgram& prog, bool value){
+    Expr* boolean = prog.arena.make<Boolean>(value);
+    boolean->_type = symbols::BOOL;
+    return boolean;
+}
+
+static Expr* make_unit(VSOPProgram& prog){
+    Expr* unit = prog.arena.make<Unit>();
+    unit->_type = symbols::UNIT;
+    return unit;
+}
+
+/**
+ * Computes base^exponent like the generated code, wrapping around,
+ * and with the integer part of 1/base^n for a negative exponent
+ */
+static int32_t integer_pow(int32_t base, int32_t exponent){
+
+    if (exponent < 0)
+        return base == 1 ? 1 : base == -1 ? ((exponent & 1) ? -1 : 1) : 0;
+
+    uint32_t result = 1, square = base;
 
-    while(_class_1 != nullptr){
-        if (inherits_from(prog, _class_2->name, _class_1->name))
-            break;
-        _class_1 = _class_1->parent_class;
+    for (uint32_t bits = exponent; bits != 0; bits >>= 1){
+
+        if (bits & 1)
+            result *= square;
+
+        square *= square;
     }
 
-    return _class_1->name;
+    return result;
 }
 
 static llvm::Value* cast_to_target(VSOPProgram& prog, CodeGenerator& coder, llvm::Value* value, llvm::Type* target_type){
@@ -69,7 +146,7 @@ static llvm::Value* cast_to_target(VSOPProgram& prog, CodeGenerator& coder, llvm
     if (is_same_as(value_type, target_type))
         return value;
 
-    if (inherits_from(prog, type_to_string(value_type), type_to_string(target_type)))
+    if (inherits_from(prog, type_to_symbol(value_type), type_to_symbol(target_type)))
         return coder.builder->CreatePointerCast(value, target_type);
 
     return nullptr;
@@ -79,25 +156,23 @@ static llvm::Value* cast_to_target(VSOPProgram& prog, CodeGenerator& coder, llvm
 // Assign class
 Assign::Assign(){}
 
-Assign::Assign(const string& name, shared_ptr<Expr> expr): name(name), expr(expr) {}
-
-Assign::Assign(const string& name, Expr* expr): name(name), expr(expr) {}
+Assign::Assign(Symbol name, Expr* expr): name(name), expr(expr) {}
 
 string Assign::print(){
-    string text = "Assign(" + name + "," + expr->print() + ")";
+    string text = "Assign(" + name.str() + "," + expr->print() + ")";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string Assign::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Assign::getType(VSOPProgram& prog, SymbolTable& scope){
     
     if (scope.look_up(name))
         _type = scope.get(name);
     else
-        _type = "unknown";
+        _type = symbols::UNKNOWN;
 
     return _type;
 }
@@ -105,19 +180,19 @@ string Assign::getType(VSOPProgram& prog, SymbolTable& scope){
 void Assign::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     expr->semanticAnalysis(prog, scope);
-    string type_expr = expr->getType(prog, scope);
+    Symbol type_expr = expr->_type;
     
     if (scope.look_up(name)){
 
-        string type_assign = scope.get(name);
+        Symbol type_assign = scope.get(name);
         if (! inherits_from(prog, type_expr, type_assign)){
-            semanticError("expected type " + type_assign + " but got type " + type_expr);
+            semanticError("expected type " + type_assign.str() + " but got type " + type_expr.str());
             prog.nb_errors++;
         }
 
     }else{
 
-        semanticError("trying to assign to undefined " + name + " variable");
+        semanticError("trying to assign to undefined " + name.str() + " variable");
         prog.nb_errors++;
         
     }
@@ -125,13 +200,27 @@ void Assign::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);   // Call to getType just to set the type of the Assign
 }
 
+bool Assign::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    // The assigned value is kept by a field or another variable
+    return expr->escapes(var, prog, true);
+}
+
+void Assign::reach(VSOPProgram& prog){
+    expr->reach(prog);
+}
+
+Expr* Assign::fold(VSOPProgram& prog){
+    expr = expr->fold(prog);
+    return this;
+}
+
 llvm::Value* Assign::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     expr->codegen(prog, coder);
 
-    llvm::Value* self_value = coder.get_val("self");
-    shared_ptr<Class> _class;
+    llvm::Value* self_value = coder.get_val(symbols::SELF);
+    Class* _class;
     if (self_value != nullptr)  // Means that we are assigning to a field of Self !
-        _class = prog.class_table[type_to_string(self_value->getType())];
+        _class = prog.class_table[type_to_symbol(self_value->getType())];
     else
         _class = nullptr;
 
@@ -177,8 +266,6 @@ llvm::Value* Assign::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 // BinOp class
 BinOp::BinOp(){}
 
-BinOp::BinOp(Value value, shared_ptr<Expr> left, shared_ptr<Expr> right): value(value), left(left), right(right) {}
-
 BinOp::BinOp(Value value, Expr* left, Expr* right): value(value), left(left), right(right) {}
 
 string BinOp::print(){
@@ -197,60 +284,60 @@ string BinOp::print(){
     }
 
     text += left->print() + "," + right->print() + ")";
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     return text;
 }
 
-string BinOp::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol BinOp::getType(VSOPProgram& prog, SymbolTable& scope){
     switch (value){
-        case EQUAL: _type = "bool"; return "bool";
-        case LOWER: _type = "bool"; return "bool";
-        case LOWER_EQ: _type = "bool"; return "bool";
-        case PLUS: _type = "int32"; return "int32";
-        case MINUS:_type = "int32"; return "int32";
-        case TIMES: _type = "int32"; return "int32";
-        case DIV: _type = "int32"; return "int32";
-        case POW: _type = "int32"; return "int32";
-        case AND: _type = "bool"; return "bool";
+        case EQUAL: _type = symbols::BOOL; return symbols::BOOL;
+        case LOWER: _type = symbols::BOOL; return symbols::BOOL;
+        case LOWER_EQ: _type = symbols::BOOL; return symbols::BOOL;
+        case PLUS: _type = symbols::INT32; return symbols::INT32;
+        case MINUS:_type = symbols::INT32; return symbols::INT32;
+        case TIMES: _type = symbols::INT32; return symbols::INT32;
+        case DIV: _type = symbols::INT32; return symbols::INT32;
+        case POW: _type = symbols::INT32; return symbols::INT32;
+        case AND: _type = symbols::BOOL; return symbols::BOOL;
     }
 }
 
 void BinOp::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
-    string expected_type;
+    Symbol expected_type;
     switch(value){
-        case EQUAL: expected_type = ""; break;
-        case LOWER: expected_type = "int32"; break;
-        case LOWER_EQ: expected_type = "int32"; break;
-        case PLUS: expected_type = "int32"; break;
-        case MINUS:expected_type = "int32"; break;
-        case TIMES: expected_type = "int32"; break;
-        case DIV: expected_type = "int32"; break;
-        case POW: expected_type = "int32"; break;
-        case AND: expected_type = "bool"; break;
+        case EQUAL: expected_type = symbols::EMPTY; break;
+        case LOWER: expected_type = symbols::INT32; break;
+        case LOWER_EQ: expected_type = symbols::INT32; break;
+        case PLUS: expected_type = symbols::INT32; break;
+        case MINUS:expected_type = symbols::INT32; break;
+        case TIMES: expected_type = symbols::INT32; break;
+        case DIV: expected_type = symbols::INT32; break;
+        case POW: expected_type = symbols::INT32; break;
+        case AND: expected_type = symbols::BOOL; break;
     }
 
     
 
     left->semanticAnalysis(prog, scope);
-    string left_type = left->getType(prog, scope);
+    Symbol left_type = left->_type;
     right->semanticAnalysis(prog, scope);
-    string right_type = right->getType(prog, scope);
+    Symbol right_type = right->_type;
 
-    if (expected_type != ""){ // Not in the case of an equality check
+    if (expected_type != symbols::EMPTY){ // Not in the case of an equality check
         if (right_type != left_type){
             semanticError("both type must be the same to use a binary operation");
             prog.nb_errors++;
         }
 
         if (left_type != expected_type){
-            semanticError("expected type " + expected_type + ", but got type " + left_type);
+            semanticError("expected type " + expected_type.str() + ", but got type " + left_type.str());
             prog.nb_errors++;
         }
 
         if (right_type != expected_type){
-            semanticError("expected type " + expected_type + ", but got type " + right_type);
+            semanticError("expected type " + expected_type.str() + ", but got type " + right_type.str());
             prog.nb_errors++;
         }
 
@@ -270,6 +357,88 @@ void BinOp::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
 }
 
+bool BinOp::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    // Comparing objects does not keep them
+    return left->escapes(var, prog, false) || right->escapes(var, prog, false);
+}
+
+void BinOp::reach(VSOPProgram& prog){
+    left->reach(prog);
+    right->reach(prog);
+}
+
+Expr* BinOp::fold(VSOPProgram& prog){
+
+    left = left->fold(prog);
+    right = right->fold(prog);
+
+    Integer* left_integer = dynamic_cast<Integer*>(left);
+    Integer* right_integer = dynamic_cast<Integer*>(right);
+    Boolean* left_boolean = dynamic_cast<Boolean*>(left);
+    Boolean* right_boolean = dynamic_cast<Boolean*>(right);
+
+    if (value == AND){
+        // false and x never evaluates x
+        if (left_boolean != nullptr)
+            return left_boolean->boolean ? right : left;
+
+        if (right_boolean != nullptr && right_boolean->boolean)
+            return left;
+
+        return this;
+    }
+
+    if (left_integer != nullptr && right_integer != nullptr){
+
+        // The arithmetic wraps around, as in the generated code
+        uint32_t a = left_integer->id, b = right_integer->id;
+
+        switch (value){
+            case PLUS: return make_integer(prog, a + b);
+            case MINUS: return make_integer(prog, a - b);
+            case TIMES: return make_integer(prog, a * b);
+            case POW: return make_integer(prog, integer_pow(left_integer->id, right_integer->id));
+            case LOWER: return make_boolean(prog, left_integer->id < right_integer->id);
+            case LOWER_EQ: return make_boolean(prog, left_integer->id <= right_integer->id);
+            case EQUAL: return make_boolean(prog, a == b);
+            case DIV:
+                // The division by zero and its overflow are left for the run time
+                if (b != 0 && !(left_integer->id == INT32_MIN && right_integer->id == -1))
+                    return make_integer(prog, left_integer->id / right_integer->id);
+                break;
+            default: break;
+        }
+    }
+
+    if (value == EQUAL){
+
+        if (left_boolean != nullptr && right_boolean != nullptr)
+            return make_boolean(prog, left_boolean->boolean == right_boolean->boolean);
+
+        String* left_string = dynamic_cast<String*>(left);
+        String* right_string = dynamic_cast<String*>(right);
+
+        // Same comparison as strcmp at run time
+        if (left_string != nullptr && right_string != nullptr)
+            return make_boolean(prog, strcmp(left_string->name.data(), right_string->name.data()) == 0);
+    }
+
+    // Neutral elements
+    if ((value == TIMES || value == DIV || value == POW) && right_integer != nullptr && right_integer->id == 1)
+        return left;
+
+    if ((value == PLUS || value == MINUS) && right_integer != nullptr && right_integer->id == 0)
+        return left;
+
+    if (value == TIMES && left_integer != nullptr && left_integer->id == 1)
+        return right;
+
+    if (value == PLUS && left_integer != nullptr && left_integer->id == 0)
+        return right;
+
+    return this;
+}
+
 llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
 
@@ -278,7 +447,25 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
          * Since in VSOP the "and" operator is shortcircuited,
          * then one can see "a && b" as if a then b else false
          */
-        return If(left, right, make_shared<Boolean>(false)).codegen_aux(prog, coder);
+        llvm::Function* function = coder.builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock* right_block = llvm::BasicBlock::Create(*coder.context, "and.right", function);
+        llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*coder.context, "and.end", function);
+
+        left->codegen(prog, coder);
+        llvm::BasicBlock* left_block_aux = coder.builder->GetInsertBlock();
+        coder.builder->CreateCondBr(left->expr_value, right_block, end_block);
+
+        coder.builder->SetInsertPoint(right_block);
+        right->codegen(prog, coder);
+        llvm::BasicBlock* right_block_aux = coder.builder->GetInsertBlock();
+        coder.builder->CreateBr(end_block);
+
+        coder.builder->SetInsertPoint(end_block);
+        llvm::PHINode* phi = coder.builder->CreatePHI(coder.to_type(symbols::BOOL), 2);
+        phi->addIncoming(llvm::ConstantInt::getFalse(*coder.context), left_block_aux);
+        phi->addIncoming(right->expr_value, right_block_aux);
+
+        return phi;
     }
     
     /** For the other cases, we just generate the llvm value for the rhs and lhs
@@ -313,29 +500,7 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     }
 
     if (value == POW){
-        return coder.builder->CreateFPToSI(
-                coder.builder->CreateCall(
-                        coder.module->getOrInsertFunction(
-                                "llvm.powi.f64",
-                                llvm::FunctionType::get(
-                                        llvm::Type::getDoubleTy(*coder.context),
-                                            {
-                                                llvm::Type::getDoubleTy(*coder.context),
-                                                coder.to_type("int32"),
-                                            },
-                                            false
-                                )
-                        ),
-                        {
-                            coder.builder->CreateSIToFP(
-                                left->expr_value,
-                                llvm::Type::getDoubleTy(*coder.context)
-                            ),
-                            right->expr_value
-                        }
-                ),
-                coder.to_type("int32")
-        );
+        return coder.create_pow(left->expr_value, right->expr_value);
     }
 
     if (value == EQUAL){
@@ -351,7 +516,7 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
                     coder.module->getOrInsertFunction(
                             "strcmp",
                             llvm::FunctionType::get(
-                                    coder.to_type("int32"),
+                                    coder.to_type(symbols::INT32),
                                     {
                                         llvm::Type::getInt8PtrTy(*coder.context),
                                         llvm::Type::getInt8PtrTy(*coder.context),
@@ -362,7 +527,7 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
                     {left->expr_value, right->expr_value}
                 );
                 // Then compare its value to the default int32 value 
-                return coder.builder->CreateICmpEQ(comp, coder.default_val("int32"));
+                return coder.builder->CreateICmpEQ(comp, coder.default_val(symbols::INT32));
 
             } else if (is_unit(left_type)){
                 // Always true, since unit has only one value
@@ -375,7 +540,7 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
             }
         } else if (is__class(left_type) && is__class(right_type)){
             // Determine first their common ancestor
-            llvm::Type* ancestor_type = prog.class_table[common_parent(prog, type_to_string(left_type),type_to_string(right_type))]->get_type(coder)->getPointerTo();
+            llvm::Type* ancestor_type = prog.class_table[common_parent(prog, type_to_symbol(left_type),type_to_symbol(right_type))]->get_type(coder)->getPointerTo();
             
             // Then check the equlity when they have been casted to their common ancestor type
             return coder.builder->CreateICmpEQ(
@@ -384,32 +549,32 @@ llvm::Value* BinOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
             );
         } else {
             
-            return coder.default_val("bool"); // SHould not reach here because Semantic analysis was already done
+            return coder.default_val(symbols::BOOL); // SHould not reach here because Semantic analysis was already done
         }
     }
 
-    return coder.default_val("int32"); // Should never reach here, but the compiler (gcc) complains about non void function not returning a value
+    return coder.default_val(symbols::INT32); // Should never reach here, but the compiler (gcc) complains about non void function not returning a value
 }
 
 // Block class
 
 Block::Block() {}
 
-Block::Block(const VSOPList<Expr>& expr): expr(expr.list) {}
+Block::Block(const VSOPList<Expr>& expr): expr(expr) {}
 
 string Block::print(){
     string text = expr.print();
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text; 
 }
 
-string Block::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Block::getType(VSOPProgram& prog, SymbolTable& scope){
     if (expr.list.empty())
-        _type = "unknown";
+        _type = symbols::UNKNOWN;
     else
-        _type = expr.list.back()->getType(prog, scope);
+        _type = expr.list.back()->_type;
     
     return _type;
 }
@@ -420,6 +585,33 @@ void Block::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool Block::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+
+    for (size_t i = 0; i < expr.list.size(); i++){
+        // Only the value of the last expression is the value of the block
+        bool last = i + 1 == expr.list.size();
+
+        if (expr.list[i]->escapes(var, prog, last && value_escapes))
+            return true;
+    }
+
+    return false;
+}
+
+void Block::reach(VSOPProgram& prog){
+
+    for (auto& it : expr.list)
+        it->reach(prog);
+}
+
+Expr* Block::fold(VSOPProgram& prog){
+
+    for (auto& it : expr.list)
+        it = it->fold(prog);
+
+    return this;
+}
+
 llvm::Value* Block::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     expr.codegen(prog, coder);
 
@@ -441,14 +633,14 @@ string Boolean::print(){
     else
         text = "false";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     
     return text;
 }
 
-string Boolean::getType(VSOPProgram& prog, SymbolTable& scope){
-    _type = "bool";
+Symbol Boolean::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = symbols::BOOL;
     return _type;
 }
 
@@ -457,28 +649,36 @@ void Boolean::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
    
 }
 
+bool Boolean::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return false;
+}
+
+void Boolean::reach(VSOPProgram& prog){}
+
+Expr* Boolean::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* Boolean::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
-    return llvm::ConstantInt::get(coder.to_type("bool"), boolean);
+    return llvm::ConstantInt::get(coder.to_type(symbols::BOOL), boolean);
 }
 
 // Call class
 
 Call::Call(){}
 
-Call::Call(shared_ptr<Expr> obj, const string& name, const VSOPList<Expr>& arguments): obj(obj), name(name), arguments(arguments.list) {}
-
-Call::Call(Expr* obj, const string& name, const VSOPList<Expr>& arguments): obj(obj), name(name), arguments(arguments.list) {}
+Call::Call(Expr* obj, Symbol name, const VSOPList<Expr>& arguments): obj(obj), name(name), arguments(arguments) {}
 
 string Call::print(){
-    string text = "Call(" + obj->print() + "," + name + "," + arguments.print() + ")";
-    if (_type != "")
-        text += ":" + _type;
+    string text = "Call(" + obj->print() + "," + name.str() + "," + arguments.print() + ")";
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     return text;
 }
 
-string Call::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Call::getType(VSOPProgram& prog, SymbolTable& scope){
     
-    string scope_type = obj->getType(prog, scope);
+    Symbol scope_type = obj->_type;
     bool control = false;
 
     if (_is_class(scope_type, prog)){
@@ -502,7 +702,7 @@ string Call::getType(VSOPProgram& prog, SymbolTable& scope){
     }
 
     // Means that we have tried to call to something which was not a class -> error
-    _type = "unknown";
+    _type = symbols::UNKNOWN;
     return _type;
 }
 
@@ -510,7 +710,7 @@ void Call::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     // Perfoms semantic on the object and get its type
     obj->semanticAnalysis(prog, scope);
-    string obj_type = obj->getType(prog, scope);
+    Symbol obj_type = obj->_type;
 
     bool control = false;
 
@@ -535,7 +735,7 @@ void Call::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
             auto _method = it->method_table[name];
             // Now check if it is called with the right number of arguments
             if (arguments.list.size() != _method->formal.list.size()){
-                semanticError("wrong number of arguments to call function " + _method->name);
+                semanticError("wrong number of arguments to call function " + _method->name.str());
                 prog.nb_errors++;
             }
 
@@ -543,26 +743,56 @@ void Call::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
                 for (int i = 0; i < arguments.list.size(); i++)
                     // Now check the return type
-                    if (! inherits_from(prog, arguments.list[i]->getType(prog, scope), _method->formal.list[i]->getType(prog, scope))){
-                        semanticError("expected type " + _method->formal.list[i]->type + " but received type " + arguments.list[i]->getType(prog, scope));
+                    if (! inherits_from(prog, arguments.list[i]->_type, _method->formal.list[i]->type)){
+                        semanticError("expected type " + _method->formal.list[i]->type.str() + " but received type " + arguments.list[i]->_type.str());
                         prog.nb_errors++;
                     }
 
             } 
 
         }else{
-            semanticError("undefined method " + name); 
+            semanticError("undefined method " + name.str()); 
             prog.nb_errors++;
         }
 
     }else{
-        semanticError(obj_type + " is not a class");
+        semanticError(obj_type.str() + " is not a class");
         prog.nb_errors++;
     }
 
     getType(prog, scope);
 }
 
+bool Call::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+
+    // The callee may keep its arguments
+    for (auto& it : arguments.list)
+        if (it->escapes(var, prog, true))
+            return true;
+
+    return obj->escapes(var, prog, receiver_escapes(prog, obj->_type, name, value_escapes));
+}
+
+void Call::reach(VSOPProgram& prog){
+
+    obj->reach(prog);
+
+    for (auto& it : arguments.list)
+        it->reach(prog);
+
+    prog.call(obj->_type, name);
+}
+
+Expr* Call::fold(VSOPProgram& prog){
+
+    obj = obj->fold(prog);
+
+    for (auto& it : arguments.list)
+        it = it->fold(prog);
+
+    return this;
+}
+
 llvm::Value* Call::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
     obj->codegen(prog, coder);
@@ -570,33 +800,44 @@ llvm::Value* Call::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
     arguments.codegen(prog, coder);
 
-    shared_ptr<Method> method;
+    Method* method;
     llvm::Function* function = nullptr;
     vector<llvm::Value*> params;
     llvm::Value* obj_value = nullptr;
 
-    if (is_unit(scope_type) || is__class(scope_type) || coder.look_up("self")){
+    if (is_unit(scope_type) || is__class(scope_type) || coder.look_up(symbols::SELF)){
 
         if (is_unit(scope_type)){   // here we are in the case some_method(param_1, ...)
-            obj_value = coder.get_val("self");
+            obj_value = coder.get_val(symbols::SELF);
         }else{
             obj_value = obj->expr_value;    //Here we are in the case obj.some_method(param_1, ...)
         }
 
         // Retrieve the class
-        shared_ptr<Class> _class = prog.class_table[type_to_string(obj_value->getType())];
+        Class* _class = prog.class_table[type_to_symbol(obj_value->getType())];
 
         method = _class->method_table[name];
 
-        function = (llvm::Function*) coder.builder->CreateLoad(     // Load the method
-                                    coder.builder->CreateStructGEP( // Get the method
-                                        coder.builder->CreateLoad(  // Load vtable
-                                            coder.builder->CreateStructGEP(obj_value, 0) // Get vtable
-                                        ),
-                                        method->index_vtable // Index of method in vtable
-                                                
-                                    )
-        );
+        // A freshly created object has an exact type, otherwise ask the class hierarchy
+        Method* target = dynamic_cast<New*>(obj) ? method : _class->unique_target(name);
+
+        if (target != nullptr){
+            // Only one method can be called: call it directly, with self casted to the class which defines it
+            function = target->get_function(coder);
+            obj_value = cast_to_target(prog, coder, obj_value, function->getFunctionType()->getParamType(0));
+
+        }else{
+
+            function = (llvm::Function*) coder.builder->CreateLoad(     // Load the method
+                                        coder.builder->CreateStructGEP( // Get the method
+                                            coder.builder->CreateLoad(  // Load vtable
+                                                coder.builder->CreateStructGEP(obj_value, 0) // Get vtable
+                                            ),
+                                            method->index_vtable // Index of method in vtable
+                                                    
+                                        )
+            );
+        }
 
         params.push_back(obj_value); // Push self as first argument
     }
@@ -605,7 +846,7 @@ llvm::Value* Call::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
         for (int i = 0; i < arguments.list.size(); i++){
 
-            if (!is_unit(arguments.list[i]->get_llvm_type()) || method->formal.list[i]->type != "unit"){
+            if (!is_unit(arguments.list[i]->get_llvm_type()) || method->formal.list[i]->type != symbols::UNIT){
                 // Cast the value for dynamic dispatch and if the type is != unit
                 llvm::Value* casted_value = cast_to_target(prog, coder, arguments.list[i]->expr_value, coder.to_type(method->formal.list[i]->type));
                 params.push_back(casted_value);
@@ -623,10 +864,10 @@ llvm::Value* Call::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
 Class::Class(){}
 
-Class::Class(const string& name, const string& parent, const VSOPList<Field>& field, const VSOPList<Method>& method): name(name), parent(parent), field(field.list), method(method.list){}
+Class::Class(Symbol name, Symbol parent, const VSOPList<Field>& field, const VSOPList<Method>& method): name(name), parent(parent), field(field), method(method){}
 
 string Class::print(){
-    string text = "Class(" + name + "," + parent + "," + field.print() + "," + method.print() + ")";
+    string text = "Class(" + name.str() + "," + parent.str() + "," + field.print() + "," + method.print() + ")";
     return text;
 }
 
@@ -642,7 +883,7 @@ void Class::declaration(VSOPProgram& prog){
 
         }else{
 
-            semanticError("redefinition of field " + (*it)->name + " of class " + name);
+            semanticError("redefinition of field " + (*it)->name.str() + " of class " + name.str());
             prog.nb_errors++;
             it = field.list.erase(it);
         }
@@ -660,7 +901,7 @@ void Class::declaration(VSOPProgram& prog){
 
         }else{
 
-            semanticError("redefinition of method " + (*_it)->name + " of class " + name);
+            semanticError("redefinition of method " + (*_it)->name.str() + " of class " + name.str());
             prog.nb_errors++;
             _it = method.list.erase(_it); // Just erase the redifined method 
         }
@@ -683,7 +924,7 @@ void Class::override(VSOPProgram& prog){
 
             if (_parent->field_table.find((*it)->name) != _parent->field_table.end()){
                 
-                semanticError("overriding field " + _parent->field_table[(*it)->name]->name + " in class " + name);
+                semanticError("overriding field " + _parent->field_table[(*it)->name]->name.str() + " in class " + name.str());
                 field_table.erase((*it)->name);
                 it = field.list.erase(it);
                 prog.nb_errors++;
@@ -724,7 +965,7 @@ void Class::override(VSOPProgram& prog){
                 if ((*iter)->return_type != _method->return_type){
 
                     control = true;
-                    semanticError("overriding method " + (*iter)->name + " with different return type");
+                    semanticError("overriding method " + (*iter)->name.str() + " with different return type");
                     prog.nb_errors++;
                     break;
 
@@ -733,7 +974,7 @@ void Class::override(VSOPProgram& prog){
                 else if((*iter)->formal.list.size() != _method->formal.list.size()){
 
                     control = true;
-                    semanticError("overriding method " + (*iter)->name + " with different number of formals");
+                    semanticError("overriding method " + (*iter)->name.str() + " with different number of formals");
                     prog.nb_errors++;
                     break;
 
@@ -741,7 +982,7 @@ void Class::override(VSOPProgram& prog){
                     // Check the types of the formals
                     for (int i = 0; i < _method->formal.list.size(); i++)
                         if((*iter)->formal.list[i]->type != _method->formal.list[i]->type){
-                            semanticError("overriding method " + (*iter)->name + " with different formal type");
+                            semanticError("overriding method " + (*iter)->name.str() + " with different formal type");
                             prog.nb_errors++;
                             control = true;
                             break;
@@ -767,45 +1008,120 @@ void Class::override(VSOPProgram& prog){
     }
 }
 
-void Class::enter_scope(SymbolTable& scope){
-    // Add all the fields in the symbol table
-    field.enter_scope(scope);
-    // Also enter the scope of the parent class
-    if (parent_class != nullptr){
-        parent_class->enter_scope(scope);
+void Class::hierarchy(unsigned& counter){
+
+    pre = counter++;
+    is_final = children.empty();
+
+    // The ancestors of the parent are already known, since it is numbered first
+    ancestors.clear();
+    if (parent_class != nullptr)
+        ancestors.push_back(parent_class);
+
+    for (size_t k = 0; k < ancestors.size() && k < ancestors[k]->ancestors.size(); k++)
+        ancestors.push_back(ancestors[k]->ancestors[k]);
+
+    for (auto& child : children){
+        child->hierarchy(counter);
+
+        // Everything that the child or its own subclasses redefine is overridden below this class
+        for (auto& it : child->method.list)
+            overridden.insert(it->name);
+
+        overridden.insert(child->overridden.begin(), child->overridden.end());
     }
+
+    post = counter++;
+}
+
+bool Class::is_subclass_of(const Class* other) const{
+
+    // The subclasses of other are exactly the classes numbered inside its interval
+    return other->pre <= pre && post <= other->post;
+}
+
+Method* Class::unique_target(Symbol name){
+
+    auto it = method_table.find(name);
+
+    if (it == method_table.end())
+        return nullptr;
+
+    // Nothing can override the methods of a final class
+    if (!is_final && overridden.find(name) != overridden.end())
+        return nullptr;
+
+    return it->second;
+}
+
+void Class::enter_scope(SymbolTable& scope){
+    scope_mark = scope.mark();
+    // The fields of the parents are already in the scope, only add the own ones
+    for (auto& it : field.list)
+        scope.insert(it->name, it->type);
     // Now self refers to this class
-    scope.insert("self", name);
+    scope.insert(symbols::SELF, name);
 }
 
 void Class::exit_scope(SymbolTable& scope){
-    // First remove self
-    scope.remove("self");
-    //Remove the scope of the parents
-    if (parent_class != nullptr)
-        parent_class->exit_scope(scope);
-    // Remove all the fields
-    field.exit_scope(scope);
+    // Remove self and all the fields at once
+    scope.restore(scope_mark);
 }
 
 void Class::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     
-    field.semanticAnalysis(prog, scope);
     enter_scope(scope);
     method.semanticAnalysis(prog, scope);
+
+    // The subclasses are analyzed inside the scope of the Class
+    for (auto& child : children)
+        child->semanticAnalysis(prog, scope);
+
     exit_scope(scope);
 }
 
-string Class::getType(VSOPProgram& prog, SymbolTable& scope){
+void Class::fold(VSOPProgram& prog){
+
+    for (auto& it : field.list)
+        it->fold(prog);
+
+    for (auto& it : method.list)
+        it->fold(prog);
+}
+
+Symbol Class::getType(VSOPProgram& prog, SymbolTable& scope){
     return name;
 }
 
 string Class::struct_name(){
-    return "struct." + name;
+    return "struct." + name.str();
+}
+
+llvm::Constant* Class::pointer_map(CodeGenerator& coder){
+
+    llvm::StructType* class_type = get_type(coder);
+    const llvm::StructLayout* layout = coder.module->getDataLayout().getStructLayout(class_type);
+    vector<llvm::Constant*> offsets;
+
+    // The vtable (element 0) is not an object, strings neither
+    for (unsigned i = 1; i < class_type->getNumElements(); i++)
+        if (is__class(class_type->getElementType(i)))
+            offsets.push_back(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*coder.context), layout->getElementOffset(i)));
+
+    if (offsets.empty())
+        return nullptr;
+
+    llvm::ArrayType* offsets_type = llvm::ArrayType::get(llvm::Type::getInt32Ty(*coder.context), offsets.size());
+    llvm::Constant* map = llvm::ConstantStruct::getAnon({
+            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*coder.context), offsets.size()),
+            llvm::ConstantArray::get(offsets_type, offsets)
+    });
+
+    return new llvm::GlobalVariable(*coder.module, map->getType(), true, llvm::GlobalValue::InternalLinkage, map, "gcmap." + name.str());
 }
 
 bool Class::is_declared(CodeGenerator& coder){
-    return coder.module->getFunction(name + "__new");
+    return coder.module->getFunction(name.str() + "__new");
 }
 
 llvm::StructType* Class::get_type(CodeGenerator& coder){
@@ -834,7 +1150,7 @@ void Class::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
     }
 
     for (auto& it : field.list){
-        if (it->type == "unit") // Unit type not stored so do not increment the index
+        if (it->type == symbols::UNIT) // Unit type not stored so do not increment the index
             it->index_vtable = field_index;
         else
             it->index_vtable = field_index++;
@@ -877,7 +1193,7 @@ void Class::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
 
         llvm::Type* field_type = coder.to_type(it.second->type);
 
-        if (it.second->type == "unit")  // If unit do not insert the field
+        if (it.second->type == symbols::UNIT)  // If unit do not insert the field
             continue;
 
         if (it.second->index_vtable >= elements_type.size())
@@ -915,30 +1231,53 @@ void Class::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
     vtable_type->setBody(elements_type);
 
     // Create new global variable which represents the class
-    llvm::GlobalVariable* vtable = new llvm::GlobalVariable(*coder.module, vtable_type, true, llvm::GlobalVariable::InternalLinkage, llvm::ConstantStruct::get(vtable_type, elements), "vtable." + name);
+    llvm::GlobalVariable* vtable = new llvm::GlobalVariable(*coder.module, vtable_type, true, llvm::GlobalVariable::InternalLinkage, llvm::ConstantStruct::get(vtable_type, elements), "vtable." + name.str());
 
     // Create the "new" functoin which has global visibility -> externalLinkage
     llvm::FunctionType* function_type = llvm::FunctionType::get(self_type->getPointerTo(), false);
-    llvm::Function* function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, name + "__new", *coder.module);
+    llvm::Function* function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, name.str() + "__new", *coder.module);
 
     // Same here for the "init" method
     function_type = llvm::FunctionType::get(llvm::Type::getVoidTy(*coder.context), {self_type->getPointerTo()}, false);
-    function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, name + "__init", *coder.module);
+    function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, name.str() + "__init", *coder.module);
     function->arg_begin()->setName("self"); // arg of init is always "self"
 }
 
 void Class::codegen(VSOPProgram& prog, CodeGenerator& coder){
+
+    Span span(name.str(), "class");
+
+    // A class that is never created keeps no initializer nor allocator (reachability)
+    if (init_reachable)
+        init_codegen(prog, coder);
+    else
+        coder.module->getFunction(name.str() + "__init")->eraseFromParent();
+
+    if (instantiated)
+        new_codegen(prog, coder);
+    else
+        coder.module->getFunction(name.str() + "__new")->eraseFromParent();
+
+    // Generate code for the methods
+    method.codegen(prog, coder);
+}
+
+void Class::init_codegen(VSOPProgram& prog, CodeGenerator& coder){
     
     // Retrieve the "init" function
-    llvm::Function* function = coder.module->getFunction(name + "__init");
+    llvm::Function* function = coder.module->getFunction(name.str() + "__init");
     // Create the block which will represent the "body" of the function. It is a container of instructions
     // that executes sequentially
     llvm::BasicBlock* entry_point = llvm::BasicBlock::Create(*coder.context, "", function);
     coder.builder->SetInsertPoint(entry_point);
 
+    // The fields may allocate, so the object being initialized is a root
+    if (coder.gc)
+        coder.builder->CreateStore(function->arg_begin(), coder.create_root(function->arg_begin()->getType()));
+
     // If there is a parent, call it's initializer
     if (parent_class != nullptr){
-        coder.builder->CreateCall(coder.module->getFunction(parent + "__init"), 
+        coder.builder->CreateCall(coder.module->getFunction(parent.str() + "__init"), 
                             {coder.builder->CreatePointerCast(
                                             function->arg_begin(), 
                                             parent_class->get_type(coder)->getPointerTo())
@@ -949,7 +1288,7 @@ void Class::codegen(VSOPProgram& prog, CodeGenerator& coder){
     for (auto& it : field.list){
         it->codegen(prog, coder); //Generate the code for the field and set its SSA value
 
-        if (it->type != "unit") // Store only if != unit
+        if (it->type != symbols::UNIT) // Store only if != unit
             coder.builder->CreateStore(it->expr_value, // store its SSA value
                                 coder.builder->CreateStructGEP(
                                     function->arg_begin(), 
@@ -960,12 +1299,15 @@ void Class::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
     // init is of return type void
     coder.builder->CreateRetVoid();
+}
+
+void Class::new_codegen(VSOPProgram& prog, CodeGenerator& coder){
 
     // Get the "new" method
-    function = coder.module->getFunction(name + "__new");
+    llvm::Function* function = coder.module->getFunction(name.str() + "__new");
 
     // Create its block
-    entry_point = llvm::BasicBlock::Create(*coder.context, "", function);
+    llvm::BasicBlock* entry_point = llvm::BasicBlock::Create(*coder.context, "", function);
     llvm::BasicBlock* init_block = llvm::BasicBlock::Create(*coder.context, "init", function);
     llvm::BasicBlock* null_block = llvm::BasicBlock::Create(*coder.context, "null", function);
 
@@ -974,17 +1316,7 @@ void Class::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
     // Computes the size of the structure we need
     size_t size = coder.module->getDataLayout().getTypeAllocSize(this->get_type(coder));
-    llvm::Value* mem = coder.builder->CreateCall(
-            coder.module->getOrInsertFunction(
-                    "malloc", 
-                    llvm::FunctionType::get(
-                            llvm::Type::getInt8PtrTy(*coder.context), 
-                            {llvm::Type::getInt64Ty(*coder.context)}, 
-                            false
-                    )
-            ),
-            {llvm::ConstantInt::get(llvm::Type::getInt64Ty(*coder.context), size)}
-    );
+    llvm::Value* mem = coder.create_alloc(size, coder.gc ? pointer_map(coder) : nullptr);
 
     // Conditional branching
     coder.builder->CreateCondBr(coder.builder->CreateIsNull(mem), null_block, init_block);
@@ -994,24 +1326,29 @@ void Class::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
     llvm::Value* instance = coder.builder->CreateBitCast(mem, this->get_type(coder)->getPointerTo());
 
-    coder.builder->CreateCall(coder.module->getFunction(name + "__init"), {instance});
+    if (coder.gc)
+        coder.builder->CreateStore(instance, coder.create_root(instance->getType()));
+
+    coder.builder->CreateCall(coder.module->getFunction(name.str() + "__init"), {instance});
 
-    coder.builder->CreateStore(coder.module->getNamedValue("vtable." + name), coder.builder->CreateStructGEP(instance, 0));
+    coder.builder->CreateStore(coder.module->getNamedValue("vtable." + name.str()), coder.builder->CreateStructGEP(instance, 0));
 
     coder.builder->CreateRet(instance);
 
     // Null block
     coder.builder->SetInsertPoint(null_block);
     coder.builder->CreateRet(llvm::ConstantPointerNull::get(this->get_type(coder)->getPointerTo()));
-
-    // Generate code for the methods
-    method.codegen(prog, coder);
 }
 
 // Expr class
 
 void Expr::codegen(VSOPProgram& prog, CodeGenerator& coder){
+    // The temporaries of the sub-expressions are dead once the expression has its value
+    size_t mark = coder.root_mark();
     expr_value = this->codegen_aux(prog, coder);
+    coder.release_roots(mark);
+    // The object must survive the collections triggered by the next allocations
+    coder.root(expr_value);
 }
 
 llvm::Type* Expr::get_llvm_type(){
@@ -1029,19 +1366,17 @@ llvm::Value* Expr::get_value(){
 
 Field::Field(){}
 
-Field::Field(const string& name, const string& type, shared_ptr<Expr> init): name(name), type(type), init(init) {}
-
-Field::Field(const string& name, const string& type, Expr* init): name(name), type(type), init(init) {}
+Field::Field(Symbol name, Symbol type, Expr* init): name(name), type(type), init(init) {}
 
 string Field::print(){
-    string text = "Field(" + name + "," + type;
+    string text = "Field(" + name.str() + "," + type.str();
     if (init)
         text += "," + init->print();
 
     return text + ")";  
 }
 
-string Field::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Field::getType(VSOPProgram& prog, SymbolTable& scope){
     _type = type;
     return type;
 }
@@ -1058,17 +1393,17 @@ void Field::exit_scope(SymbolTable& scope){
 void Field::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     if (!is_primitive(type) && !_is_class(type, prog)){
-        semanticError("unknown type " + type);
+        semanticError("unknown type " + type.str());
         prog.nb_errors++;
     }
 
     if (init != nullptr){
 
         init->semanticAnalysis(prog, scope);
-        string type_init = init->getType(prog, scope);
+        Symbol type_init = init->_type;
         
         if (!inherits_from(prog, type_init, type)){
-            semanticError("got type " + type_init + ", but expected type " + type);
+            semanticError("got type " + type_init.str() + ", but expected type " + type.str());
             prog.nb_errors++;
         }
     }
@@ -1076,6 +1411,20 @@ void Field::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+void Field::reach(VSOPProgram& prog){
+
+    if (init != nullptr)
+        init->reach(prog);
+}
+
+Expr* Field::fold(VSOPProgram& prog){
+
+    if (init != nullptr)
+        init = init->fold(prog);
+
+    return this;
+}
+
 llvm::Value* Field::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
     llvm::Type* field_type = coder.to_type(type);
@@ -1099,10 +1448,10 @@ llvm::Value* Field::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
 Formal::Formal() {};
 
-Formal::Formal(const string& name, const string& type): name(name), type(type) {}
+Formal::Formal(Symbol name, Symbol type): name(name), type(type) {}
 
 string Formal::print(){
-    return name + ":" + type;
+    return name.str() + ":" + type.str();
 }
 
 void Formal::enter_scope(SymbolTable& scope){
@@ -1115,12 +1464,12 @@ void Formal::exit_scope(SymbolTable& scope){
 
 void Formal::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     if (!is_primitive(type) && !_is_class(type, prog)){
-        semanticError("unknown type " + type);
+        semanticError("unknown type " + type.str());
         prog.nb_errors++;
     }
 }
 
-string Formal::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Formal::getType(VSOPProgram& prog, SymbolTable& scope){
 
     return type;
 }
@@ -1129,22 +1478,22 @@ string Formal::getType(VSOPProgram& prog, SymbolTable& scope){
 
 Identifier::Identifier(){}
 
-Identifier::Identifier(const string& name): name(name) {}
+Identifier::Identifier(Symbol name): name(name) {}
 
 string Identifier::print(){
-    string text = name;
-    if (_type != "")
-        text += ":" + _type;
+    string text = name.str();
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string Identifier::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol Identifier::getType(VSOPProgram& prog, SymbolTable& scope){
     
     if (scope.look_up(name)){
         _type = scope.get(name);
     }else{
-        _type = "unknown";
+        _type = symbols::UNKNOWN;
     }
 
     return _type;
@@ -1152,12 +1501,22 @@ string Identifier::getType(VSOPProgram& prog, SymbolTable& scope){
 
 void Identifier::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     if (! scope.look_up(name)){
-        semanticError("undefined identifier: " + name);
+        semanticError("undefined identifier: " + name.str());
         prog.nb_errors++;
     }
     getType(prog, scope);
 }
 
+bool Identifier::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return value_escapes && name == var;
+}
+
+void Identifier::reach(VSOPProgram& prog){}
+
+Expr* Identifier::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* Identifier::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
     // Check if the name of the identifier is in the symbol table
@@ -1165,11 +1524,11 @@ llvm::Value* Identifier::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
         return coder.load(name);
 
     // Else it is a field of self
-    llvm::Value* self = coder.get_val("self");
-    shared_ptr<Class> _class;
+    llvm::Value* self = coder.get_val(symbols::SELF);
+    Class* _class;
 
     if (self != nullptr){
-        _class = prog.class_table[type_to_string(self->getType())];
+        _class = prog.class_table[type_to_symbol(self->getType())];
 
     }else{
 
@@ -1196,8 +1555,6 @@ llvm::Value* Identifier::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 // If class
 If::If(){}
 
-If::If(shared_ptr<Expr> cond, shared_ptr<Expr> then, shared_ptr<Expr> else_expr): cond(cond), then(then), else_expr(else_expr){}
-
 If::If(Expr* cond, Expr* then, Expr* else_expr): cond(cond), then(then), else_expr(else_expr) {}
 
 string If::print(){
@@ -1207,25 +1564,25 @@ string If::print(){
         text += "," + else_expr->print();
     text += ")";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string If::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol If::getType(VSOPProgram& prog, SymbolTable& scope){
     
-    string type_then = then->getType(prog, scope);
-    string type_else;
+    Symbol type_then = then->_type;
+    Symbol type_else;
 
     if (else_expr != nullptr)
-        type_else = else_expr->getType(prog, scope);
+        type_else = else_expr->_type;
     else
-        type_else = "unit";
+        type_else = symbols::UNIT;
 
-    if (type_else == "unit" || type_then == "unit"){
+    if (type_else == symbols::UNIT || type_then == symbols::UNIT){
 
-        _type = "unit";
+        _type = symbols::UNIT;
         return _type;
     }
     else if (is_primitive(type_then) && type_then == type_else){
@@ -1237,7 +1594,7 @@ string If::getType(VSOPProgram& prog, SymbolTable& scope){
         _type = common_parent(prog, type_then, type_else);
         return _type;
     }
-    _type = "unknown";
+    _type = symbols::UNKNOWN;
     return _type;
 
 }
@@ -1246,7 +1603,7 @@ void If::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     cond->semanticAnalysis(prog, scope);
 
-    if (cond->getType(prog, scope) != "bool"){
+    if (cond->_type != symbols::BOOL){
         semanticError("condition must have type bool");
         prog.nb_errors++;
     }
@@ -1256,12 +1613,53 @@ void If::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     if (else_expr != nullptr)
         else_expr->semanticAnalysis(prog, scope);
 
-    if (getType(prog, scope) == "unknown"){
+    if (getType(prog, scope) == symbols::UNKNOWN){
         semanticError("types of the condition do not agree");
         prog.nb_errors++;
     }
+}
 
-    getType(prog, scope);
+bool If::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+
+    if (cond->escapes(var, prog, false) || then->escapes(var, prog, value_escapes))
+        return true;
+
+    return else_expr != nullptr && else_expr->escapes(var, prog, value_escapes);
+}
+
+void If::reach(VSOPProgram& prog){
+
+    cond->reach(prog);
+    then->reach(prog);
+
+    if (else_expr != nullptr)
+        else_expr->reach(prog);
+}
+
+Expr* If::fold(VSOPProgram& prog){
+
+    cond = cond->fold(prog);
+    then = then->fold(prog);
+
+    if (else_expr != nullptr)
+        else_expr = else_expr->fold(prog);
+
+    Boolean* boolean = dynamic_cast<Boolean*>(cond);
+
+    if (boolean != nullptr){
+
+        Expr* taken = boolean->boolean ? then : else_expr;
+
+        // Without else, the if is of type unit
+        if (taken == nullptr)
+            return make_unit(prog);
+
+        // Otherwise the branch must not need to be casted to the type of the if
+        if (taken->_type == _type)
+            return taken;
+    }
+
+    return this;
 }
 
 llvm::Value* If::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
@@ -1311,7 +1709,7 @@ llvm::Value* If::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
         end_type = then_type;
 
     else if (is__class(then_type) && is__class(else_type))
-        end_type = prog.class_table[common_parent(prog, type_to_string(then_type), type_to_string(else_type))]->get_type(coder)->getPointerTo();
+        end_type = prog.class_table[common_parent(prog, type_to_symbol(then_type), type_to_symbol(else_type))]->get_type(coder)->getPointerTo();
 
     coder.builder->SetInsertPoint(then_block_aux);
 
@@ -1347,15 +1745,15 @@ Integer::Integer(int id): id(id) {}
 
 string Integer::print(){
     string text = to_string(id);
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string Integer::getType(VSOPProgram& prog, SymbolTable& scope){
-    _type = "int32";
-    return "int32";
+Symbol Integer::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = symbols::INT32;
+    return symbols::INT32;
 }
 
 void Integer::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
@@ -1363,6 +1761,16 @@ void Integer::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool Integer::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return false;
+}
+
+void Integer::reach(VSOPProgram& prog){}
+
+Expr* Integer::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* Integer::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     return llvm::ConstantInt::get(llvm::Type::getInt32Ty(*coder.context), id);
 }
@@ -1370,26 +1778,22 @@ llvm::Value* Integer::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 // Let class
 Let::Let(){}
 
-Let::Let(const string& name, const string& type, shared_ptr<Expr> init, shared_ptr<Expr> scope): name(name), type(type), init(init), scope(scope) {}
-
-Let::Let(const string& name, const string& type, Expr* init, Expr* scope): name(name), type(type), init(init), scope(scope) {}
+Let::Let(Symbol name, Symbol type, Expr* init, Expr* scope): name(name), type(type), init(init), scope(scope) {}
 
 string Let::print(){
-    string text = "Let(" + name + "," + type;
+    string text = "Let(" + name.str() + "," + type.str();
     if (init)
         text += "," + init->print();
     text += "," + scope->print() + ")";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string Let::getType(VSOPProgram& prog, SymbolTable& scope){
-    enter_scope(scope);
-    _type = this->scope->getType(prog ,scope);
-    exit_scope(scope);
+Symbol Let::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = this->scope->_type;
     return _type;
 
 }
@@ -1405,17 +1809,17 @@ void Let::exit_scope(SymbolTable& scope){
 void Let::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     if (!is_primitive(type) && !_is_class(type, prog)){
-        semanticError("unknown type: " + type);
+        semanticError("unknown type: " + type.str());
         prog.nb_errors++;
     }
 
     if (init != nullptr){
 
         init->semanticAnalysis(prog, scope);
-        string type_init = init->getType(prog, scope);
+        Symbol type_init = init->_type;
 
         if (!inherits_from(prog, type_init, type)){
-            semanticError("expected type: " + type + " but received: " + type_init);
+            semanticError("expected type: " + type.str() + " but received: " + type_init.str());
             prog.nb_errors++;
         }
     }
@@ -1427,6 +1831,37 @@ void Let::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool Let::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+
+    // The initial value is kept by the new variable
+    if (init != nullptr && init->escapes(var, prog, true))
+        return true;
+
+    // Inside its scope, the variable of the Let hides var
+    if (name == var)
+        return false;
+
+    return scope->escapes(var, prog, value_escapes);
+}
+
+void Let::reach(VSOPProgram& prog){
+
+    if (init != nullptr)
+        init->reach(prog);
+
+    scope->reach(prog);
+}
+
+Expr* Let::fold(VSOPProgram& prog){
+
+    if (init != nullptr)
+        init = init->fold(prog);
+
+    scope = scope->fold(prog);
+
+    return this;
+}
+
 llvm::Value* Let::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
     llvm::Type* let_type = coder.to_type(type);
@@ -1434,7 +1869,20 @@ llvm::Value* Let::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     if (let_type != nullptr){
         llvm::Value* casted_value = nullptr;
 
-        if (init != nullptr){
+        New* _new = dynamic_cast<New*>(init);
+
+        if (_new != nullptr && !coder.gc && _new->type != symbols::OBJECT && !scope->escapes(name, prog, true)){
+
+            // The object dies with the scope of the Let, it can live in the frame of the function
+            Class* _class = prog.class_table[_new->type];
+            llvm::Value* instance = coder.create_stack_object(_class->get_type(coder));
+
+            coder.builder->CreateCall(coder.module->getFunction(_new->type.str() + "__init"), {instance});
+            coder.builder->CreateStore(coder.module->getNamedValue("vtable." + _new->type.str()), coder.builder->CreateStructGEP(instance, 0));
+
+            casted_value = cast_to_target(prog, coder, instance, let_type);
+
+        }else if (init != nullptr){
 
             init->codegen(prog, coder);
 
@@ -1455,7 +1903,8 @@ llvm::Value* Let::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
     scope->codegen(prog, coder);
 
-    coder.remove(name);
+    // The slot of the variable is free for the next Let of the method
+    coder.release(name);
 
     return scope->expr_value;
 }
@@ -1464,12 +1913,10 @@ llvm::Value* Let::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
 Method::Method(){}
 
-Method::Method(const string& name, const string& return_type, const VSOPList<Formal>& formal, shared_ptr<Block> block): name(name), return_type(return_type), formal(formal.list), block(block){}
-
-Method::Method(const string& name, const string& return_type, const VSOPList<Formal>& formal, Block* block): name(name), return_type(return_type), formal(formal.list), block(block){}
+Method::Method(Symbol name, Symbol return_type, const VSOPList<Formal>& formal, Block* block): name(name), return_type(return_type), formal(formal), block(block){}
 
 string Method::print(){
-    string text = "Method(" + name + "," +   formal.print() + "," + return_type;
+    string text = "Method(" + name.str() + "," +   formal.print() + "," + return_type.str();
     if (block != nullptr)
         text +=  "," + block->print();
     return text + ")";
@@ -1477,18 +1924,18 @@ string Method::print(){
 
 void Method::declaration(VSOPProgram& prog){
     // Declare all the formals of the method, and check for redefinition
+    unordered_set<Symbol> names;
 
     auto it = formal.list.begin();
     while(it != formal.list.end()){
         
-        if (formal_table.find((*it)->name) == formal_table.end()){
+        if (names.insert((*it)->name).second){
             
-            formal_table[(*it)->name] = *it;
             it++;
 
         }else{
 
-            semanticError("redefinition of formal " + (*it)->name + " of method " + name);
+            semanticError("redefinition of formal " + (*it)->name.str() + " of method " + name.str());
             it = formal.list.erase(it);
             prog.nb_errors++;
         }
@@ -1501,22 +1948,26 @@ void Method::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     formal.semanticAnalysis(prog, scope);
 
     if (! _is_class(return_type, prog) && ! is_primitive(return_type)){
-        semanticError("unknown type: " + return_type);
+        semanticError("unknown type: " + return_type.str());
         prog.nb_errors++;
     }
 
     enter_scope(scope);
     block->semanticAnalysis(prog, scope);
-    string block_type = block->getType(prog, scope);
+    Symbol block_type = block->_type;
     exit_scope(scope);
 
     if (! inherits_from(prog, block_type, return_type)){
-        semanticError("return type of function is " + return_type + " but received " + block_type);
+        semanticError("return type of function is " + return_type.str() + " but received " + block_type.str());
         prog.nb_errors++;
     }
 
 }
 
+void Method::fold(VSOPProgram& prog){
+    block->fold(prog);
+}
+
 void Method::enter_scope(SymbolTable& scope){
     formal.enter_scope(scope);
 }
@@ -1535,7 +1986,7 @@ void Method::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
     params_type.push_back((llvm::Type*) parent->get_type(coder)->getPointerTo());
 
     for (auto& it : formal.list)
-        if (it->type != "unit")
+        if (it->type != symbols::UNIT)
             params_type.push_back(coder.to_type(it->type));
 
     // Get the protoype of the function we want to define
@@ -1549,8 +2000,8 @@ void Method::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
     it++;
     
     for (auto& _it : formal.list){
-        if (_it->type != "unit"){
-            it->setName(_it->name);
+        if (_it->type != symbols::UNIT){
+            it->setName(_it->name.str());
             it++;
         }
     }
@@ -1558,7 +2009,7 @@ void Method::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
 }
 
 string Method::get_name(){
-    return parent->name + "_" + name;
+    return parent->name.str() + "_" + name.str();
 }
 
 llvm::Function* Method::get_function(CodeGenerator& coder){
@@ -1576,22 +2027,34 @@ llvm::FunctionType* Method::get_type(CodeGenerator& coder){
 
 void Method::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
+    Span span(get_name(), "method");
+
     // Get the method that has been declared in pre_codegen
     llvm::Function* function = this->get_function(coder);
     llvm::BasicBlock* entry_point = llvm::BasicBlock::Create(*coder.context, "", function);
     coder.builder->SetInsertPoint(entry_point);
 
+    // The method is still in the vtables, but it can never be called
+    if (!reachable){
+        coder.builder->CreateUnreachable();
+        return;
+    }
+
     auto it = function->arg_begin();
+    size_t mark = coder.scope.mark();
     
     // Now, we will add all the formals of the method + self to the scope
-    coder.insert("self", it);
+    coder.insert(symbols::SELF, it);
+
+    if (coder.gc)
+        coder.builder->CreateStore(it, coder.create_root(it->getType()));
     it++;
 
     for (auto& _it : formal.list){
 
-        if (_it->type != "unit"){
-            coder.allocate(it->getName(), it->getType());
-            coder.store(it->getName(), it);
+        if (_it->type != symbols::UNIT){
+            coder.allocate(_it->name, it->getType());
+            coder.store(_it->name, it);
             it++;
         }else{
             coder.insert(_it->name, nullptr);
@@ -1601,10 +2064,7 @@ void Method::codegen(VSOPProgram& prog, CodeGenerator& coder){
     block->codegen(prog, coder);
 
     // Once the code for the block has been generated, we can remove the formals & self from the scope
-    coder.remove("self");
-
-    for (auto& _it : formal.list)
-        coder.remove(_it->name);
+    coder.scope.restore(mark);
 
     // Get the return type of the function
     llvm::Type* _return_type = function->getReturnType();
@@ -1629,17 +2089,17 @@ void Method::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
 New::New(){}
 
-New::New(const string& type): type(type) {}
+New::New(Symbol type): type(type) {}
 
 string New::print(){
-    string text = "New(" + type + ")";
+    string text = "New(" + type.str() + ")";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     return text;
 }
 
-string New::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol New::getType(VSOPProgram& prog, SymbolTable& scope){
     _type = type;
     return type;
 }
@@ -1647,16 +2107,41 @@ string New::getType(VSOPProgram& prog, SymbolTable& scope){
 void New::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     if (!_is_class(type, prog)){
-        semanticError("trying to use New operator on unknown type: " + type);
+        semanticError("trying to use New operator on unknown type: " + type.str());
         prog.nb_errors++;
     }
 
     getType(prog, scope);
 }
 
+bool New::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return false;
+}
+
+void New::reach(VSOPProgram& prog){
+    prog.instantiate(prog.class_table[type]);
+}
+
+Expr* New::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* New::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
+
+    if (coder.gc && type == symbols::OBJECT){
+        // Object__new of the runtime uses malloc, but the collector must own every object
+        Class* object_class = prog.class_table[symbols::OBJECT];
+        llvm::Type* object_type = object_class->get_type(coder)->getPointerTo();
+        size_t size = coder.module->getDataLayout().getTypeAllocSize(object_class->get_type(coder));
+
+        llvm::Value* instance = coder.builder->CreateBitCast(coder.create_alloc(size), object_type);
+        coder.builder->CreateCall(coder.module->getFunction("Object__init"), {instance});
+
+        return instance;
+    }
+
     // Get the "new" function
-    llvm::Function* function = coder.module->getFunction(type + "__new");
+    llvm::Function* function = coder.module->getFunction(type.str() + "__new");
     // Then call it, and returns its value
     if (function != nullptr)
         return coder.builder->CreateCall(function, {});
@@ -1667,27 +2152,27 @@ llvm::Value* New::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 // Node class
 
 void Node::semanticError(const std::string& msg){
-    std::cerr << file_name + ":" + std::to_string(line) + ":" + std::to_string(col) + ": semantic error: " + msg << std::endl;
+    *diagnostics << (file_name != nullptr ? *file_name : string()) + ":" + std::to_string(line) + ":" + std::to_string(col) + ": semantic error: " + msg << std::endl;
 }
 
 // Self class
 
-Self::Self(): Identifier("self") {}
+Self::Self(): Identifier(symbols::SELF) {}
 
 llvm::Value* Self::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
-    return coder.get_val("self");
+    return coder.get_val(symbols::SELF);
 }
 
 // String class
 
-String::String(){}
+String::String(): name("") {}
 
-String::String(const string& name): name(name) {}
+String::String(llvm::StringRef name): name(name) {}
 
 string String::print(){
     string text = "\"";
 
-    for (char& c : name){
+    for (char c : name){
 
         switch(c){
             case '\"': text += char_to_hex(c); break;
@@ -1702,22 +2187,32 @@ string String::print(){
 
     text += "\"";
     
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     return text;
 }
 
-string String::getType(VSOPProgram& prog, SymbolTable& scope){
-    _type = "string";
-    return "string";
+Symbol String::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = symbols::STRING;
+    return symbols::STRING;
 }
 
 void String::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool String::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return false;
+}
+
+void String::reach(VSOPProgram& prog){}
+
+Expr* String::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* String::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
-    return coder.builder->CreateGlobalStringPtr(name, "str");
+    return coder.string_constant(name.str());
 }
 // Unit class
 
@@ -1725,14 +2220,14 @@ Unit::Unit(){}
 
 string Unit::print(){
     string text = "()";
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string Unit::getType(VSOPProgram& prog, SymbolTable& scope){
-    _type = "unit";
+Symbol Unit::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = symbols::UNIT;
     return _type;
 }
 
@@ -1740,6 +2235,16 @@ void Unit::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool Unit::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return false;
+}
+
+void Unit::reach(VSOPProgram& prog){}
+
+Expr* Unit::fold(VSOPProgram& prog){
+    return this;
+}
+
 llvm::Value* Unit::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     return nullptr;
 }
@@ -1747,8 +2252,6 @@ llvm::Value* Unit::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 // UnOp class
 UnOp::UnOp(){}
 
-UnOp::UnOp(Value value, shared_ptr<Expr> expr): value(value), expr(expr) {}
-
 UnOp::UnOp(Value value, Expr* expr): value(value), expr(expr) {}
 
 string UnOp::print(){
@@ -1764,44 +2267,72 @@ string UnOp::print(){
 
     text += expr->print() + ")";
 
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
 
     return text;
 }
 
-string UnOp::getType(VSOPProgram& prog, SymbolTable& scope){
+Symbol UnOp::getType(VSOPProgram& prog, SymbolTable& scope){
     switch(value){
-        case NOT: _type = "bool"; return "bool";
-        case MINUS:_type = "int32"; return "int32";
-        case ISNULL: _type = "bool"; return "bool";
+        case NOT: _type = symbols::BOOL; return symbols::BOOL;
+        case MINUS:_type = symbols::INT32; return symbols::INT32;
+        case ISNULL: _type = symbols::BOOL; return symbols::BOOL;
     }
 }
 
 void UnOp::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
-    string expected_type;
+    Symbol expected_type;
 
     switch(value){
-        case NOT: expected_type = "bool"; 
+        case NOT: expected_type = symbols::BOOL; 
                   break;
-        case MINUS:expected_type = "int32";
+        case MINUS:expected_type = symbols::INT32;
                     break;
-        case ISNULL: expected_type = "Object"; 
+        case ISNULL: expected_type = symbols::OBJECT; 
                     break;
     }
 
     expr->semanticAnalysis(prog, scope);
-    string expr_type = expr->getType(prog, scope);
+    Symbol expr_type = expr->_type;
 
     if(! inherits_from(prog, expr_type, expected_type)){
-        semanticError("expected type " + expected_type + " but received type " + expr_type);
+        semanticError("expected type " + expected_type.str() + " but received type " + expr_type.str());
         prog.nb_errors++;
     }
 
     getType(prog, scope);
 }
 
+bool UnOp::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    return expr->escapes(var, prog, false);
+}
+
+void UnOp::reach(VSOPProgram& prog){
+    expr->reach(prog);
+}
+
+Expr* UnOp::fold(VSOPProgram& prog){
+
+    expr = expr->fold(prog);
+
+    // not not x and - - x are x
+    UnOp* inner = dynamic_cast<UnOp*>(expr);
+    if (inner != nullptr && inner->value == value && value != ISNULL)
+        return inner->expr;
+
+    Boolean* boolean = dynamic_cast<Boolean*>(expr);
+    if (value == NOT && boolean != nullptr)
+        return make_boolean(prog, !boolean->boolean);
+
+    Integer* integer = dynamic_cast<Integer*>(expr);
+    if (value == MINUS && integer != nullptr)
+        return make_integer(prog, - (uint32_t) integer->id);
+
+    return this;
+}
+
 llvm::Value* UnOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     // Generate code for the rhs
     expr->codegen(prog, coder);
@@ -1819,9 +2350,13 @@ llvm::Value* UnOp::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
 
 // VSOPProgram class
 
-VSOPProgram::VSOPProgram(){}
+VSOPProgram::VSOPProgram(): program(&arena){
+    file_name = &path;
+}
 
-VSOPProgram::VSOPProgram(const VSOPList<Class>& program): program(program.list){}
+VSOPProgram::VSOPProgram(const VSOPList<Class>& program): program(program){
+    file_name = &path;
+}
 
 string VSOPProgram::print(){
     return program.print();
@@ -1830,32 +2365,32 @@ string VSOPProgram::print(){
 void VSOPProgram::declaration(){
 
     // Declare first the Object class and insert it inside the class table
-    auto arg_1 = make_shared<VSOPList<Formal>>();
-    arg_1->push(new Formal("s", "string"));
-    auto arg_2 = make_shared<VSOPList<Formal>>();
-    arg_2->push(new Formal("b", "bool"));
-    auto arg_3 = make_shared<VSOPList<Formal>>();
-    arg_3->push(new Formal("i", "int32"));
-    auto arg_4 = make_shared<VSOPList<Formal>>();
-    auto arg_5 = make_shared<VSOPList<Formal>>();
-    auto arg_6 = make_shared<VSOPList<Formal>>();
-
-    auto methods = make_shared<VSOPList<Method>>();
-    methods->push(new Method("print", "Object", *arg_1, nullptr));
-    methods->push(new Method("inputInt32", "int32", *arg_6,  nullptr));
-    methods->push(new Method("inputBool", "bool", *arg_5,  nullptr));
-    methods->push(new Method("inputLine", "string", *arg_4, nullptr));
-    methods->push(new Method("printInt32", "Object", *arg_3, nullptr));
-    methods->push(new Method("printBool", "Object", *arg_2, nullptr));
-
-    auto fields = make_shared<VSOPList<Field>>();
-
-    auto object_class = make_shared<Class>("Object", "Object", *fields, *methods);
-
-    for(const auto& method : methods->list)
+    VSOPList<Formal> arg_1(&arena);
+    arg_1.push(arena.make<Formal>(Symbol::intern("s"), symbols::STRING));
+    VSOPList<Formal> arg_2(&arena);
+    arg_2.push(arena.make<Formal>(Symbol::intern("b"), symbols::BOOL));
+    VSOPList<Formal> arg_3(&arena);
+    arg_3.push(arena.make<Formal>(Symbol::intern("i"), symbols::INT32));
+    VSOPList<Formal> arg_4(&arena);
+    VSOPList<Formal> arg_5(&arena);
+    VSOPList<Formal> arg_6(&arena);
+
+    VSOPList<Method> methods(&arena);
+    methods.push(arena.make<Method>(Symbol::intern("print"), symbols::OBJECT, arg_1, nullptr));
+    methods.push(arena.make<Method>(Symbol::intern("inputInt32"), symbols::INT32, arg_6,  nullptr));
+    methods.push(arena.make<Method>(Symbol::intern("inputBool"), symbols::BOOL, arg_5,  nullptr));
+    methods.push(arena.make<Method>(Symbol::intern("inputLine"), symbols::STRING, arg_4, nullptr));
+    methods.push(arena.make<Method>(Symbol::intern("printInt32"), symbols::OBJECT, arg_3, nullptr));
+    methods.push(arena.make<Method>(Symbol::intern("printBool"), symbols::OBJECT, arg_2, nullptr));
+
+    VSOPList<Field> fields;
+
+    auto object_class = arena.make<Class>(symbols::OBJECT, symbols::OBJECT, fields, methods);
+
+    for(const auto& method : methods.list)
         object_class->method_table[method->name] = method;
 
-    class_table["Object"] = object_class;
+    class_table[symbols::OBJECT] = object_class;
 
     // Declare the other classes that are present inside the AST
     auto it = program.list.begin();
@@ -1869,7 +2404,7 @@ void VSOPProgram::declaration(){
             
         }else{
             
-            semanticError("Redefinition of class " + (*it)->name);
+            semanticError("Redefinition of class " + (*it)->name.str());
             it = program.list.erase(it); // Just erase the redifined class just for not messing up other operations
             nb_errors++;
         }
@@ -1877,25 +2412,25 @@ void VSOPProgram::declaration(){
 
     // Check if the Main class is present
 
-    if(class_table.find("Main") == class_table.end()){
+    if(class_table.find(symbols::MAIN) == class_table.end()){
 
         semanticError("class Main is undefined, it must be present in your program!");
         nb_errors++;
 
     }else{
 
-        auto main = class_table["Main"];
+        auto main = class_table[symbols::MAIN];
         // Check if there is a main method
-        if (main->method_table.find("main") == main->method_table.end()){
+        if (main->method_table.find(symbols::MAIN_METHOD) == main->method_table.end()){
 
             semanticError("main method of class Main is undefined!");
             nb_errors++;
 
         }else{
 
-            auto main_method = main->method_table["main"];
+            auto main_method = main->method_table[symbols::MAIN_METHOD];
             
-            if(main_method->formal.list.size() > 0 || main_method->return_type != "int32"){
+            if(main_method->formal.list.size() > 0 || main_method->return_type != symbols::INT32){
 
                 semanticError("main method must take no arguments and have a int32 return type");
                 nb_errors++;
@@ -1912,14 +2447,14 @@ void VSOPProgram::declaration(){
 
     while(iter != program.list.end()){
 
-        string class_name = (*iter)->name;
+        Symbol class_name = (*iter)->name;
         auto _iter = (*iter);
 
-        while(_iter->parent != "Object"){
+        while(_iter->parent != symbols::OBJECT){
 
             if(class_name == _iter->parent){
                 // Means that we have a class which extends from itself... => Cycle detected
-                semanticError("class " + (*iter)->name + " cannot extend class " + (*iter)->parent);
+                semanticError("class " + (*iter)->name.str() + " cannot extend class " + (*iter)->parent.str());
                 nb_errors++;
                 class_table.erase(class_name);
                 iter = program.list.erase(iter);
@@ -1934,7 +2469,7 @@ void VSOPProgram::declaration(){
             }else{
 
                 control = true;
-                semanticError("class " + (*iter)->name + " cannot extend class " + (*iter)->parent);
+                semanticError("class " + (*iter)->name.str() + " cannot extend class " + (*iter)->parent.str());
                 nb_errors++;
                 class_table.erase(class_name);
                 iter = program.list.erase(iter);              
@@ -1960,11 +2495,151 @@ void VSOPProgram::declaration(){
 
     for(auto& _class : program.list)
         _class->override(*this);
+
+    hierarchy();
+}
+
+void VSOPProgram::hierarchy(){
+
+    for (auto& it : program.list)
+        if (it->parent_class != nullptr)
+            it->parent_class->children.push_back(it);
+
+    // Object is the root of the hierarchy
+    unsigned counter = 0;
+    class_table[symbols::OBJECT]->hierarchy(counter);
+}
+
+void VSOPProgram::escape_analysis(){
+
+    // The methods of Object come from the runtime, they may return self but never keep it
+    for (auto& it : class_table[symbols::OBJECT]->method.list)
+        it->returns_self = !is_primitive(it->return_type);
+
+    // Start from nothing escaping and only add escapes, so it always ends. A method is
+    // analyzed again only when a method it calls has changed
+    std::vector<Method*> worklist;
+    std::unordered_set<Method*> pending;
+
+    for (auto& _class : program.list)
+        for (auto& it : _class->method.list)
+            if (pending.insert(it).second)
+                worklist.push_back(it);
+
+    while (!worklist.empty()){
+
+        Method* it = worklist.back();
+        worklist.pop_back();
+        pending.erase(it);
+
+        escape_method = it;
+        bool self_escapes = it->block->escapes(symbols::SELF, *this, false);
+        bool returns_self = !is_primitive(it->return_type) && it->block->escapes(symbols::SELF, *this, true);
+        escape_method = nullptr;
+
+        if (self_escapes == it->self_escapes && returns_self == it->returns_self)
+            continue;
+
+        it->self_escapes = self_escapes;
+        it->returns_self = returns_self;
+
+        for (Method* caller : escape_callers[it])
+            if (pending.insert(caller).second)
+                worklist.push_back(caller);
+    }
+
+    escape_callers.clear();
+}
+
+void VSOPProgram::fold(){
+
+    for (auto& it : program.list)
+        it->fold(*this);
+}
+
+void VSOPProgram::reachability(){
+
+    // The main function creates a Main object and calls its main method
+    instantiate(class_table[symbols::MAIN]);
+    mark_reachable(class_table[symbols::MAIN]->method_table[symbols::MAIN_METHOD]);
+
+    while (!reachable_methods.empty()){
+
+        Method* method = reachable_methods.back();
+        reachable_methods.pop_back();
+
+        if (method->block != nullptr)
+            method->block->reach(*this);
+    }
+}
+
+void VSOPProgram::instantiate(Class* _class){
+
+    if (_class->instantiated)
+        return;
+
+    _class->instantiated = true;
+
+    // The initializer also runs the ones of the parents
+    for (Class* it = _class; it != nullptr && !it->init_reachable; it = it->parent_class){
+
+        it->init_reachable = true;
+
+        for (auto& _field : it->field.list)
+            _field->reach(*this);
+    }
+
+    // The calls already seen on the class or its ancestors may reach its methods
+    for (Class* it = _class; it != nullptr; it = it->parent_class){
+
+        auto sites = call_sites.find(it);
+
+        if (sites != call_sites.end())
+            for (auto& name : sites->second)
+                mark_reachable(_class->method_table[name]);
+    }
+}
+
+void VSOPProgram::call(Symbol type, Symbol name){
+
+    Class* _class = class_table[type];
+
+    if (!call_sites[_class].insert(name).second)
+        return;
+
+    // Only the classes below the static type of the receiver may be reached
+    std::vector<Class*> below = {_class};
+
+    while (!below.empty()){
+
+        Class* it = below.back();
+        below.pop_back();
+
+        if (it->instantiated)
+            mark_reachable(it->method_table[name]);
+
+        below.insert(below.end(), it->children.begin(), it->children.end());
+    }
+}
+
+void VSOPProgram::mark_reachable(Method* method){
+
+    if (method->reachable)
+        return;
+
+    method->reachable = true;
+    reachable_methods.push_back(method);
 }
 
 void VSOPProgram::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
-    program.semanticAnalysis(prog, scope);
+    // The initializers of the fields see neither the fields nor self
+    for (auto& it : program.list)
+        it->field.semanticAnalysis(prog, scope);
+
+    // The methods are analyzed in a walk of the hierarchy from Object
+    for (auto& it : class_table[symbols::OBJECT]->children)
+        it->semanticAnalysis(prog, scope);
 }
 
 void VSOPProgram::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
@@ -1978,22 +2653,28 @@ void VSOPProgram::pre_codegen(VSOPProgram& prog, CodeGenerator& coder){
 
 void VSOPProgram::codegen(VSOPProgram& prog, CodeGenerator& coder){
 
+    reachability();
+
+    // The objects are only allocated on the stack without the collector
+    if (!coder.gc)
+        escape_analysis();
+
     // codegen for all the classes
     program.codegen(prog, coder);
 
     // Define the prototype of the main function
-    llvm::FunctionType* function_type = llvm::FunctionType::get(coder.to_type("int32"), {}, false);
+    llvm::FunctionType* function_type = llvm::FunctionType::get(coder.to_type(symbols::INT32), {}, false);
     // Create the main function
     llvm::Function* function = llvm::Function::Create(function_type, llvm::Function::ExternalLinkage, "main", *coder.module);
 
     llvm::BasicBlock* entry_point = llvm::BasicBlock::Create(*coder.context, "", function);
     coder.builder->SetInsertPoint(entry_point);
 
-    auto _main = new New("Main");
-    auto args = make_shared<VSOPList<Expr>>();
+    New _main(symbols::MAIN);
+    VSOPList<Expr> args;
 
     // call to Main.main()
-    coder.builder->CreateRet(Call(_main, "main", *args).codegen_aux(prog, coder));
+    coder.builder->CreateRet(Call(&_main, symbols::MAIN_METHOD, args).codegen_aux(prog, coder));
 
     
 }
@@ -2001,30 +2682,28 @@ void VSOPProgram::codegen(VSOPProgram& prog, CodeGenerator& coder){
 // While class
 While::While(){}
 
-While::While(shared_ptr<Expr> cond, shared_ptr<Expr> body): cond(cond), body(body){}
-
 While::While(Expr* cond, Expr* body): cond(cond), body(body){}
 
 string While::print(){
     
     string text = "While(" + cond->print() + "," + body->print() + ")";
-    if (_type != "")
-        text += ":" + _type;
+    if (_type != symbols::EMPTY)
+        text += ":" + _type.str();
     return text;
 }
 
-string While::getType(VSOPProgram& prog, SymbolTable& scope){
-    _type = "unit";
+Symbol While::getType(VSOPProgram& prog, SymbolTable& scope){
+    _type = symbols::UNIT;
     return _type;
 }
 
 void While::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
 
     cond->semanticAnalysis(prog, scope);
-    string type_condition = cond->getType(prog, scope);
+    Symbol type_condition = cond->_type;
 
-    if (type_condition != "bool"){
-        semanticError("expected type bool for condition, but got type: " + type_condition);
+    if (type_condition != symbols::BOOL){
+        semanticError("expected type bool for condition, but got type: " + type_condition.str());
         prog.nb_errors++;
     }
 
@@ -2033,6 +2712,30 @@ void While::semanticAnalysis(VSOPProgram& prog, SymbolTable& scope){
     getType(prog, scope);
 }
 
+bool While::escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+    // The value of a while is unit
+    return cond->escapes(var, prog, false) || body->escapes(var, prog, false);
+}
+
+void While::reach(VSOPProgram& prog){
+    cond->reach(prog);
+    body->reach(prog);
+}
+
+Expr* While::fold(VSOPProgram& prog){
+
+    cond = cond->fold(prog);
+    body = body->fold(prog);
+
+    Boolean* boolean = dynamic_cast<Boolean*>(cond);
+
+    // The body of a while false is never executed
+    if (boolean != nullptr && !boolean->boolean)
+        return make_unit(prog);
+
+    return this;
+}
+
 llvm::Value* While::codegen_aux(VSOPProgram& prog, CodeGenerator& coder){
     
     llvm::Function* function = coder.builder->GetInsertBlock()->getParent();
@@ -9,8 +9,10 @@
 #include <memory>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <iostream>
 #include <algorithm>
+#include "Arena.hpp"
 #include "SymbolTable.hpp"
 #include "CodeGenerator.hpp"
 #include "utils.hpp"
@@ -28,12 +30,11 @@ class Node
 
     public:
 
-        Node() {}   // Constructor
-        virtual ~Node() {}  // Destructor
+        Node() {}   // Constructor, no destructor so that the Arena does not destroy the nodes one by one
 
         int line = 1;   // line in the file
         int col = 1;    // Column in the file
-        std::string file_name;
+        const std::string* file_name = nullptr;    // Path of the file, owned by the VSOPProgram
 
 
         /**
@@ -75,6 +76,7 @@ class Node
 
 
 class Class;    // Class declaration here, definition below
+class Method;   // Class declaration here, definition below
 class Block;    // Class declaration here, definition below
 class Field;    // Class declaration here, definition below
 
@@ -87,42 +89,16 @@ class Field;    // Class declaration here, definition below
 template <typename T>
 class VSOPList : public Node{
     public:
-            std::vector<std::shared_ptr<T>> list;
-
-            explicit VSOPList() {}; // Constructor
-
-            /**
-             * Creates a new VSOPList
-             * 
-             * @param elements A vector of elements to be stored in the list
-             * 
-             * @returns A new VSOPList which has a list of elements
-             */
-            explicit VSOPList(std::vector<std::shared_ptr<T>> elements){
-                for(std::shared_ptr<T> element : elements)
-                    list.push_back(element);
-            }
+            ArenaVector<T*> list;   // A copy of the VSOPList shares the elements
 
             /**
-             * Creates a new VSOPList
+             * Creates a new empty VSOPList
              * 
-             * @param elements A vector of elements to be stored in the list
+             * @param arena The Arena of the elements, only needed to push
              * 
-             * @returns A new VSOPList which has a list of elements
+             * @returns A new empty VSOPList
              */
-            explicit VSOPList(std::vector<T*> elements){
-                for(T* element : elements)
-                    list.push_back(std::shared_ptr<T>(element));
-            }
-
-            /**
-             * Push a new node inside the list
-             * 
-             * @param element The element to be pushed in the list
-             */
-            void push(std::shared_ptr<T> element){
-                list.push_back(element);
-            }
+            explicit VSOPList(Arena* arena = nullptr): list(arena) {}
 
             /**
              * Push a new node inside the list
@@ -130,7 +106,7 @@ class VSOPList : public Node{
              * @param element The element to be pushed in the list
              */
             void push(T* element){
-                list.push_back(std::shared_ptr<T>(element));
+                list.push_back(element);
             }
 
             /**
@@ -181,8 +157,9 @@ class VSOPList : public Node{
              */
             void exit_scope(SymbolTable& scope){
 
-                for (auto& element : list)
-                    element->exit_scope(scope);
+                // Reverse order, so that the names are removed from the innermost
+                for (auto element = list.rbegin(); element != list.rend(); element++)
+                    (*element)->exit_scope(scope);
             }
 
             /**
@@ -215,10 +192,17 @@ class VSOPList : public Node{
  */
 class VSOPProgram : public Node{
     public:
+            Arena arena;    // Owns all the nodes of the program, declared first so it is destroyed last
+            std::string path;   // Path of the source file as given, shared by the nodes for their errors
             VSOPList<Class> program;
-            std::unordered_map<std::string, std::shared_ptr<Class>> class_table;
+            std::unordered_map<Symbol, Class*> class_table;
             int nb_errors = 0;
 
+            std::unordered_map<Class*, std::unordered_set<Symbol>> call_sites;  // Names of the methods called, by static class of the receiver
+            std::vector<Method*> reachable_methods;     // Methods reached whose body is not walked yet
+            Method* escape_method = nullptr;    // Method whose escapes are being computed
+            std::unordered_map<Method*, std::unordered_set<Method*>> escape_callers;   // Methods whose escapes read those of each method
+
             explicit VSOPProgram(); // Constructor
 
             /**
@@ -246,6 +230,59 @@ class VSOPProgram : public Node{
              */
             void declaration();
 
+            /**
+             * Builds the class hierarchy from the parent classes, once
+             * the declaration is done. It is used to answer the subtyping
+             * queries and to devirtualize the calls whose target is known
+             * statically.
+             */
+            void hierarchy();
+
+            /**
+             * Computes which methods may let self escape. The methods can
+             * call each other, so a method is analyzed again when one of
+             * the methods it calls changes, until nothing changes. It is
+             * used to allocate on the stack the objects that do not escape.
+             */
+            void escape_analysis();
+
+            /**
+             * Folds the constants and simplifies the expressions of all the
+             * classes, between the semantic analysis and the code generation.
+             */
+            void fold();
+
+            /**
+             * Computes the classes that may be instantiated and the methods
+             * that may be called when running Main.main (rapid type
+             * analysis). A call reaches the method of every instantiated
+             * class below the static type of its receiver. The code of the
+             * other methods is not generated.
+             */
+            void reachability();
+
+            /**
+             * Records that an object of a class may be created
+             * 
+             * @param _class The class of the object
+             */
+            void instantiate(Class* _class);
+
+            /**
+             * Records a call site of a method
+             * 
+             * @param type The static type of the receiver
+             * @param name The name of the method
+             */
+            void call(Symbol type, Symbol name);
+
+            /**
+             * Records that a method may be called
+             * 
+             * @param method The method
+             */
+            void mark_reachable(Method* method);
+
             /**
              * Performs the semantic analysis on the VSOPProgram.
              * 
@@ -276,8 +313,8 @@ class VSOPProgram : public Node{
  */
 class Formal : public Node{
     public:
-            std::string name;
-            std::string type;
+            Symbol name;
+            Symbol type;
 
             explicit Formal();  // Constructor
 
@@ -289,7 +326,7 @@ class Formal : public Node{
              *
              * @returns a new Formal Object
              */
-            explicit Formal(const std::string& name, const std::string& type);
+            explicit Formal(Symbol name, Symbol type);
 
             /**
              * Computes the string representation of the Formal
@@ -326,7 +363,7 @@ class Formal : public Node{
              * @param prog The VSOPProgram which contains the Formal
              * @param scope The SymbolTable which represents the scope
              */
-            std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 };
 
 /**
@@ -334,29 +371,21 @@ class Formal : public Node{
  */
 class Method : public Node{
     public:
-            std::string name;
-            std::string return_type;
+            Symbol name;
+            Symbol return_type;
 
             VSOPList<Formal> formal;
-            std::shared_ptr<Block> block;
-            std::unordered_map<std::string, std::shared_ptr<Formal>> formal_table;
+            Block* block = nullptr;
 
             Class* parent = nullptr;    // Class which implements this method.
             int index_vtable;
 
+            bool self_escapes = false;  // self may be stored or given away by the method
+            bool returns_self = false;  // self may be returned by the method
+            bool reachable = false;     // The method may be called from Main.main
+
             explicit Method();  // Constructor
 
-            /**
-             * Creates a new Method object
-             * 
-             * @param name The name of the Method
-             * @param return_type The return type of the Method
-             * @param formal The list of formals of the Method
-             * @param block The block of the Method
-             * 
-             * @returns a new Method object.
-             */
-            explicit Method(const std::string& name, const std::string& return_type, const VSOPList<Formal>& formal, std::shared_ptr<Block> block);
 
             /**
              * Creates a new Method object
@@ -368,7 +397,7 @@ class Method : public Node{
              * 
              * @returns a new Method object.
              */
-            explicit Method(const std::string& name, const std::string& return_type, const VSOPList<Formal>& formal, Block* block);
+            explicit Method(Symbol name, Symbol return_type, const VSOPList<Formal>& formal, Block* block);
 
             /**
              * Computes the string representation of the Method
@@ -407,6 +436,13 @@ class Method : public Node{
              */
             void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * Folds the constants in the body of the Method
+             * 
+             * @param prog The VSOPProgram which contains the Method
+             */
+            void fold(VSOPProgram& prog);
+
             /**
              * Declares the Method inside the CodeGenerator
              * 
@@ -451,15 +487,27 @@ class Method : public Node{
  */
 class Class : public Node{
     public:
-            std::string name;
-            std::string parent;
+            Symbol name;
+            Symbol parent;
 
-            std::shared_ptr<Class> parent_class = nullptr;
+            Class* parent_class = nullptr;
 
             VSOPList<Field> field;
             VSOPList<Method> method;
-            std::unordered_map<std::string, std::shared_ptr<Field>> field_table;
-            std::unordered_map<std::string, std::shared_ptr<Method>> method_table;
+            std::unordered_map<Symbol, Field*> field_table;
+            std::unordered_map<Symbol, Method*> method_table;
+
+            std::vector<Class*> children;   // Classes that directly extend this class
+            std::unordered_set<Symbol> overridden;  // Methods redefined somewhere below this class
+            bool is_final = false;  // No class extends this class
+            bool instantiated = false;  // An object of exactly this class may be created
+            bool init_reachable = false;    // The initializers of the fields may be executed
+
+            unsigned pre = 0;   // Position of the Class in a preorder walk of the hierarchy
+            unsigned post = 0;  // Position of the Class in a postorder walk of the hierarchy
+            std::vector<Class*> ancestors;  // ancestors[k] is the 2^k-th ancestor of the Class
+
+            size_t scope_mark = 0;  // State of the scope before entering the Class
 
             explicit Class();   // Constructor
 
@@ -473,7 +521,7 @@ class Class : public Node{
              * 
              * @returns a new Class object.
              */
-            explicit Class(const std::string& name, const std::string& parent, const VSOPList<Field>& field, const VSOPList<Method>& method);
+            explicit Class(Symbol name, Symbol parent, const VSOPList<Field>& field, const VSOPList<Method>& method);
 
             /**
              * Computes the string representation of the Class
@@ -499,7 +547,36 @@ class Class : public Node{
             void override(VSOPProgram& prog);
 
             /**
-             * Enters the scope of the Class
+             * Numbers the Class and its subclasses, and computes the methods
+             * that are redefined by the subclasses of the Class, and whether
+             * the Class is final.
+             * 
+             * @param counter The next number of the walk of the hierarchy
+             */
+            void hierarchy(unsigned& counter);
+
+            /**
+             * Determines whether the Class inherits from another one,
+             * in constant time.
+             * 
+             * @param other The supposed ancestor
+             * 
+             * @returns true if the Class is other or one of its subclasses
+             */
+            bool is_subclass_of(const Class* other) const;
+
+            /**
+             * Determines the only method that can be reached when calling
+             * a method on an object whose static type is the Class.
+             * 
+             * @param name The name of the method
+             * 
+             * @returns The method, or nullptr if a subclass overrides it
+             */
+            Method* unique_target(Symbol name);
+
+            /**
+             * Enters the scope of the Class, on top of the scope of its parent
              * 
              * @param scope The symbolTable which represents the scope
              */
@@ -513,13 +590,21 @@ class Class : public Node{
             void exit_scope(SymbolTable& scope);
 
             /**
-             * Performs the semantic Analysis of the Class
+             * Performs the semantic Analysis of the methods of the Class,
+             * then of its subclasses, which see its fields under their own
              * 
              * @param prog The VSOPProgram which contains the Class
              * @param scope The SymbolTable which represents the scope
              */
             void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * Folds the constants in the fields and the methods of the Class
+             * 
+             * @param prog The VSOPProgram which contains the Class
+             */
+            void fold(VSOPProgram& prog);
+
             /**
              * Get the type of the Class
              * 
@@ -528,7 +613,7 @@ class Class : public Node{
              * 
              * @returns the type of the Class
              */
-            std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * Declares the Class inside the CodeGenerator
@@ -546,6 +631,24 @@ class Class : public Node{
              */
             virtual void codegen(VSOPProgram& prog, CodeGenerator& coder);
 
+            /**
+             * Generate the body of the initializer of the Class, which
+             * initializes its fields and those of its parents.
+             * 
+             * @param prog The VSOPProgram which contains the Class
+             * @param coder The CodeGenerator which will generate the code.
+             */
+            void init_codegen(VSOPProgram& prog, CodeGenerator& coder);
+
+            /**
+             * Generate the body of the allocator of the Class, which
+             * allocates an object and initializes it.
+             * 
+             * @param prog The VSOPProgram which contains the Class
+             * @param coder The CodeGenerator which will generate the code.
+             */
+            void new_codegen(VSOPProgram& prog, CodeGenerator& coder);
+
             /**
              * Get the name of the Class inside a CodeGenerator
              * 
@@ -553,6 +656,16 @@ class Class : public Node{
              */
             std::string struct_name();
 
+            /**
+             * Emits the pointer map of the Class for the garbage collector,
+             * i.e. the offsets of the fields that point to objects.
+             * 
+             * @param coder The CodeGenerator which contains the structure of the Class
+             * 
+             * @returns The global of the map, or nullptr if there is no such field
+             */
+            llvm::Constant* pointer_map(CodeGenerator& coder);
+
             /**
              * Determines if the Class is declared inside a CodeGenerator
              * 
@@ -581,18 +694,20 @@ class Expr: public Node
 {
     public:
 
-            std::string _type = "";
+            Symbol _type = symbols::EMPTY;   // Set once by the semantic analysis
             llvm::Value* expr_value = nullptr;
 
             /**
-             * Get the type of the Expr
+             * Computes the type of the Expr and stores it in _type.
+             * It only reads the _type of the sub-expressions, so
+             * it must be called once they have been analysed.
              * 
              * @param prog The VSOPProgram which contains the Expr
              * @param scope The SymbolTable which represents the scope.
              * 
              * @returns The type of the Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope) = 0;
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope) = 0;
 
             /**
              * Performs the semantic Analysis of the Expr
@@ -602,6 +717,41 @@ class Expr: public Node
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope) = 0;
 
+            /**
+             * Determines whether the object bound to a variable may outlive
+             * the evaluation of the Expr, by being stored in a field or in
+             * another variable, given as argument or returned. It must be
+             * called after the semantic analysis.
+             * 
+             * @param var The name of the variable
+             * @param prog The VSOPProgram which contains the Expr
+             * @param value_escapes Whether the value of the Expr itself escapes
+             * 
+             * @returns false if the object surely does not escape, true else
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes){
+                return true;
+            }
+
+            /**
+             * Records the classes that the Expr instantiates and the
+             * methods that it calls, for the reachability analysis.
+             * 
+             * @param prog The VSOPProgram which contains the Expr
+             */
+            virtual void reach(VSOPProgram& prog) = 0;
+
+            /**
+             * Folds the constant sub-expressions of the Expr and simplifies
+             * them, once the semantic analysis is done. The replacements
+             * always have the same type as what they replace.
+             * 
+             * @param prog The VSOPProgram which contains the Expr
+             * 
+             * @returns The Expr that replaces this one, possibly itself
+             */
+            virtual Expr* fold(VSOPProgram& prog) = 0;
+
             /**
              * Generate the code for the Expr.
              * 
@@ -639,23 +789,13 @@ class Expr: public Node
 
 class Field : public Expr{
     public:
-            std::string name;
-            std::string type;
-            std::shared_ptr<Expr> init;
+            Symbol name;
+            Symbol type;
+            Expr* init = nullptr;
             int index_vtable;
 
             explicit Field();   // Constructor
 
-            /**
-             * Creates a new Field object
-             * 
-             * @param name The name of the Field
-             * @param type The type of the Field
-             * @param init The init expression of the Field (can be nullptr)
-             * 
-             * @returns a new Field object.
-             */
-            explicit Field(const std::string& name, const std::string& type, std::shared_ptr<Expr> init);
 
             /**
              * Creates a new Field object
@@ -666,7 +806,7 @@ class Field : public Expr{
              * 
              * @returns a new Field object.
              */
-            explicit Field(const std::string& name, const std::string& type, Expr* init);
+            explicit Field(Symbol name, Symbol type, Expr* init);
 
             /**
              * @see Expr
@@ -676,7 +816,7 @@ class Field : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * Enters the scope of the Field
@@ -697,6 +837,16 @@ class Field : public Expr{
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -726,13 +876,28 @@ class Block: public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -742,24 +907,13 @@ class Block: public Expr{
 
 class Let : public Expr{
     public:
-            std::string name;
-            std::string type;
-            std::shared_ptr<Expr> init;
-            std::shared_ptr<Expr> scope;
+            Symbol name;
+            Symbol type;
+            Expr* init = nullptr;
+            Expr* scope = nullptr;
 
             explicit Let(); // Constructor
 
-            /**
-             * Creates a new Let object
-             * 
-             * @param name The name of the Let
-             * @param type The type of the Let
-             * @param init The init expression of the Let (can be nullptr)
-             * @param scope The scope of the Let
-             * 
-             * @returns a new Let object.
-             */
-            explicit Let(const std::string& name, const std::string& type, std::shared_ptr<Expr> init, std::shared_ptr<Expr> scope);
 
             /**
              * Creates a new Let object
@@ -771,7 +925,7 @@ class Let : public Expr{
              * 
              * @returns a new Let object.
              */
-            explicit Let(const std::string& name, const std::string& type, Expr* init, Expr* scope);
+            explicit Let(Symbol name, Symbol type, Expr* init, Expr* scope);
             
             /**
              * @see Expr
@@ -781,13 +935,28 @@ class Let : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * Enters the scope of the Let
              * 
@@ -810,22 +979,12 @@ class Let : public Expr{
 
 class Call : public Expr{
     public:
-            std::shared_ptr<Expr> obj;
-            std::string name;
+            Expr* obj = nullptr;
+            Symbol name;
             VSOPList<Expr> arguments;
 
             explicit Call();    // Constructor
 
-            /**
-             * Creates a new Call object
-             * 
-             * @param obj The object of the Call
-             * @param name The name of the Call
-             * @param arguments The arguments of the Call
-             * 
-             * @returns a new Call object.
-             */
-            explicit Call(std::shared_ptr<Expr> obj, const std::string& name, const VSOPList<Expr>& arguments);
 
             /**
              * Creates a new Call object
@@ -836,7 +995,7 @@ class Call : public Expr{
              * 
              * @returns a new Call object.
              */
-            explicit Call(Expr* obj, const std::string& name, const VSOPList<Expr>& arguments);
+            explicit Call(Expr* obj, Symbol name, const VSOPList<Expr>& arguments);
 
             /**
              * @see Expr
@@ -846,13 +1005,28 @@ class Call : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -861,22 +1035,12 @@ class Call : public Expr{
 
 class If : public Expr{
     public:
-            std::shared_ptr<Expr> cond;
-            std::shared_ptr<Expr> then;
-            std::shared_ptr<Expr> else_expr;
+            Expr* cond = nullptr;
+            Expr* then = nullptr;
+            Expr* else_expr = nullptr;
 
             explicit If();  // Constructor
 
-            /**
-             * Creates a new If object
-             * 
-             * @param cond The condition of the If
-             * @param then The then of the If
-             * @param else_expr The else of the If
-             * 
-             * @returns a new If object.
-             */
-            explicit If(std::shared_ptr<Expr> cond, std::shared_ptr<Expr> then, std::shared_ptr<Expr> else_expr);
             
             /**
              * Creates a new If object
@@ -897,13 +1061,28 @@ class If : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -914,20 +1093,11 @@ class If : public Expr{
 
 class While : public Expr{
     public:
-            std::shared_ptr<Expr> cond;
-            std::shared_ptr<Expr> body;
+            Expr* cond = nullptr;
+            Expr* body = nullptr;
 
             explicit While();   // Constructor
 
-            /**
-             * Creates a new While object
-             * 
-             * @param cond The condition of the While
-             * @param body The body of the While
-             * 
-             * @returns a new While object.
-             */
-            explicit While(std::shared_ptr<Expr> cond, std::shared_ptr<Expr> body);
 
             /**
              * Creates a new While object
@@ -947,13 +1117,28 @@ class While : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -963,7 +1148,7 @@ class While : public Expr{
 
 class New : public Expr{
     public:
-            std::string type;
+            Symbol type;
 
             explicit New(); // Constructor
 
@@ -974,7 +1159,7 @@ class New : public Expr{
              * 
              * @returns a new New object.
              */
-            explicit New(const std::string& type);
+            explicit New(Symbol type);
 
             /**
              * @see Expr
@@ -984,13 +1169,28 @@ class New : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1020,13 +1220,28 @@ class Boolean : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1037,21 +1252,11 @@ class BinOp : public Expr{
     public:
             enum Value {EQUAL, LOWER, LOWER_EQ, PLUS, MINUS, TIMES, DIV, POW, AND};
             Value value;
-            std::shared_ptr<Expr> right;
-            std::shared_ptr<Expr> left;
+            Expr* right = nullptr;
+            Expr* left = nullptr;
 
             explicit BinOp();   // Constructor
 
-            /**
-             * Creates a new BinOp object
-             * 
-             * @param value The type of operation of the BinOp
-             * @param left The left hand side of the BinOp
-             * @param right The right hand side of the BinOp
-             * 
-             * @returns a new BinOp object.
-             */
-            explicit BinOp(Value value, std::shared_ptr<Expr> left, std::shared_ptr<Expr> right);
 
             /**
              * Creates a new BinOp object
@@ -1071,13 +1276,28 @@ class BinOp : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1087,20 +1307,11 @@ class BinOp : public Expr{
 
 class Assign : public Expr{
     public: 
-            std::string name;
-            std::shared_ptr<Expr> expr;
+            Symbol name;
+            Expr* expr = nullptr;
 
             explicit Assign();  // COnstructor
 
-            /**
-             * Creates a new Assign object
-             * 
-             * @param name The name of the Assign
-             * @param expr The right hand side of the Assign
-             * 
-             * @returns a new Assign object.
-             */
-            explicit Assign(const std::string& name, std::shared_ptr<Expr> expr);
 
             /**
              * Creates a new Assign object
@@ -1110,7 +1321,7 @@ class Assign : public Expr{
              * 
              * @returns a new Assign object.
              */
-            explicit Assign(const std::string& name, Expr* expr);
+            explicit Assign(Symbol name, Expr* expr);
 
             /**
              * @see Expr
@@ -1120,13 +1331,28 @@ class Assign : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1135,7 +1361,7 @@ class Assign : public Expr{
 
 class Identifier : public Expr{
     public:
-            std::string name;
+            Symbol name;
 
             explicit Identifier();  // Constructor
 
@@ -1146,7 +1372,7 @@ class Identifier : public Expr{
              * 
              * @returns a new Identifier object.
              */
-            explicit Identifier(const std::string& name);
+            explicit Identifier(Symbol name);
 
             /**
              * @see Expr
@@ -1156,13 +1382,28 @@ class Identifier : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1192,13 +1433,28 @@ class Integer : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1217,18 +1473,18 @@ class Self : public Identifier{
 
 class String : public Expr{
     public:
-            std::string name;
+            llvm::StringRef name;   // Not owned, in the Arena of the program for the parsed literals
 
             explicit String();  // Constructor
             
             /**
              * Creates a new String object
              * 
-             * @param name The name of the String
+             * @param name The name of the String, which must outlive it
              * 
              * @returns a new String object.
              */
-            explicit String(const std::string& name);
+            explicit String(llvm::StringRef name);
 
             /**
              * @see Expr
@@ -1238,13 +1494,28 @@ class String : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1264,13 +1535,28 @@ class Unit : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1281,19 +1567,10 @@ class UnOp : public Expr{
     public:
             enum Value {NOT, MINUS, ISNULL};
             Value value;
-            std::shared_ptr<Expr> expr;
+            Expr* expr = nullptr;
 
             explicit UnOp();    // Constructor
 
-            /**
-             * Creates a new UnOp object
-             * 
-             * @param value The type of operation of the UnOp
-             * @param expr The right hand side of the UnOp
-             * 
-             * @returns a new UnOp object.
-             */
-            explicit UnOp(Value value, std::shared_ptr<Expr> expr);
             explicit UnOp(Value value, Expr* expr);
 
             /**
@@ -1304,13 +1581,28 @@ class UnOp : public Expr{
             /**
              * @see Expr
              */
-            virtual std::string getType(VSOPProgram& prog, SymbolTable& scope);
+            virtual Symbol getType(VSOPProgram& prog, SymbolTable& scope);
 
             /**
              * @see Expr
              */
             virtual void semanticAnalysis(VSOPProgram& prog, SymbolTable& scope);
 
+            /**
+             * @see Expr
+             */
+            virtual bool escapes(Symbol var, VSOPProgram& prog, bool value_escapes);
+
+            /**
+             * @see Expr
+             */
+            virtual void reach(VSOPProgram& prog);
+
+            /**
+             * @see Expr
+             */
+            virtual Expr* fold(VSOPProgram& prog);
+
             /**
              * @see Expr
              */
@@ -1326,7 +1618,7 @@ class UnOp : public Expr{
  * 
  * @returns true if var is primitive, false else.
  */
-bool is_primitive(const std::string& var);
+bool is_primitive(Symbol var);
 
 /**
  * Determines whether a type is a class or not.
@@ -1335,7 +1627,7 @@ bool is_primitive(const std::string& var);
  * 
  * @returns true if var is primitve, false else.
  */
-bool _is_class(const std::string& var, VSOPProgram& prog);
+bool _is_class(Symbol var, VSOPProgram& prog);
 
 /**
  * Determines whether type_1 inherits from type_2
@@ -1345,7 +1637,7 @@ bool _is_class(const std::string& var, VSOPProgram& prog);
  * 
  * @returns true if type_1 inherits from type_2, false else
  */
-bool inherits_from(VSOPProgram& prog, const std::string& type_1, const std::string& type_2);
+bool inherits_from(VSOPProgram& prog, Symbol type_1, Symbol type_2);
 
 /**
  * Determines the common parent of two types
@@ -1355,6 +1647,6 @@ bool inherits_from(VSOPProgram& prog, const std::string& type_1, const std::stri
  * 
  * @returns The common parent of type_1 and type_2
  */
-std::string common_parent(VSOPProgram& prog, const std::string& type_1, const std::string& type_2);
+Symbol common_parent(VSOPProgram& prog, Symbol type_1, Symbol type_2);
 
 #endif
\ No newline at end of file
@@ -1,7 +1,10 @@
 #include "utils.hpp"
+#include <iostream>
 
 using namespace std;
 
+thread_local ostream* diagnostics = &cerr;
+
 char escape_to_char(const char* c){
 
     if (c[1] == 'x')
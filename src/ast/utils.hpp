@@ -2,6 +2,7 @@
 #define UTILS_HPP
 
 #include <cstdlib>
+#include <ostream>
 #include <string>
 
 // Converts an escape sequence to char
@@ -11,5 +12,8 @@ char hex_to_char(std::string s);
 // Converts a char to an hexadecimal representation
 std::string char_to_hex(char c);
 
+// Stream where the errors of the file compiled by the current thread are written
+extern thread_local std::ostream* diagnostics;
+
 
 #endif
\ No newline at end of file
@@ -1,99 +1,535 @@
+#include <cerrno>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "vsop.tab.h"
 #include "ast/ast.hpp"
 #include "ast/CodeGenerator.hpp"
+#include "ast/Server.hpp"
+#include "ast/Cache.hpp"
 
-extern int yyparse(void);
-std::string file_name;
-extern FILE* yyin;
-int mode = 0;
-VSOPProgram* vsop;
-VSOPList<Class> program;
+/**
+ * Options of the command line, the same for all the files to compile.
+ */
+struct Options{
+    std::string option = "";
+    int opt_level = -1;    // -1 when no -O flag is given
+    bool ast_stats = false;
+    bool bump_alloc = false;
+    bool gc = false;
+    bool buffered_io = false;
+    bool whole_program = true;
+    std::string directory;  // Where the relative paths are, empty for the working directory
+    Cache* cache = nullptr; // Artifacts of the previous compilations, if a cache is given
+};
 
-int main(int argc, char const *argv[])
-{   
-    if (argc != 3 && argc != 2){
-        std::cerr << "vsopc: bad number of arguments" << std::endl;
-        return 1;
+/**
+ * Runs a tool without a shell, so that the paths are passed as they are
+ *
+ * @param args The name of the tool, looked up in the PATH, then its arguments
+ * @param errors The stream where the messages of the tool are written
+ *
+ * @returns true if the tool has succeeded, false else
+ */
+static bool run_tool(const std::vector<std::string>& args, std::ostream& errors){
+
+    std::vector<char*> argv;
+
+    for (auto& arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+
+    argv.push_back(nullptr);
+
+    // The messages of the tool go with the diagnostics of the file, which may be sent to a client
+    int messages[2];
+
+    if (pipe2(messages, O_CLOEXEC) != 0)
+        return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, messages[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, messages[1], STDERR_FILENO);
+
+    pid_t pid;
+    bool spawned = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) == 0;
+
+    posix_spawn_file_actions_destroy(&actions);
+    close(messages[1]);
+
+    char buffer[4096];
+    ssize_t length;
+
+    while ((length = read(messages[0], buffer, sizeof(buffer))) > 0)
+        errors.write(buffer, length);
+
+    close(messages[0]);
+
+    if (!spawned){
+        errors << "vsopc: cannot run " << args[0] << std::endl;
+        return false;
     }
-    std::string option = "";
-    if (argc == 3)
-        option = argv[1];
 
-    if (option == "-lex" || option == "-l")
-        mode = START_LEX;
+    int status;
 
-    if (option == "-p" || option == "-c" || option == "-i" || option == "")
-        mode = START_PARSE;
+    while (waitpid(pid, &status, 0) < 0)
+        if (errno != EINTR)
+            return false;
 
-    if (mode == 0){
-        std::cerr << "vsopc: error in arguments" << std::endl;
-        return 1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Compiles one file, from the parsing to the link
+ *
+ * @param path The path of the VSOP file
+ * @param options The options of the command line
+ * @param output The stream where the results (-p, -c, -i) are written
+ * @param errors The stream where the diagnostics are written
+ *
+ * @returns The exit code of the compilation of the file
+ */
+static int compile(const std::string& path, const Options& options, std::ostream& output, std::ostream& errors){
+
+    const std::string& option = options.option;
+
+    // The path is kept as given in the diagnostics, the files are read and written at the real one
+    std::string real_path = path[0] == '/' || options.directory.empty() ? path : options.directory + "/" + path;
+
+    // The semantic errors found on this thread go to the stream of this file
+    diagnostics = &errors;
+
+    std::string basename = real_path.substr(0, real_path.find_last_of('.'));
+    Cache::Files artifacts = {{"program.o", basename + ".o"}};
+
+    if (option == "")
+        artifacts.push_back({"program", basename});
+
+    // A compilation done before with the same source, compiler, flags and runtime is not done again
+    std::string key;
+
+    // -ast-stats describes the compilation itself, which a hit would skip
+    if (options.cache != nullptr && !options.ast_stats && (option == "" || option == "-emit-obj" || option == "-i")){
+        Span span("cache", "phase");
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> source = llvm::MemoryBuffer::getFile(real_path);
+
+        if (source){
+            // Without -O, the IR is not optimized and the other artifacts are at -O2: the same entries as the explicit levels
+            int opt_level = options.opt_level >= 0 ? options.opt_level : option == "-i" ? 0 : 2;
+            std::string flags = option + " -O" + std::to_string(opt_level) + (options.bump_alloc ? " -alloc=bump" : "")
+                              + (options.gc ? " -gc" : "") + (options.buffered_io ? " -buffered-io" : "") + (options.whole_program ? "" : " -no-whole-program");
+            key = options.cache->key((*source)->getBuffer(), flags);
+
+            std::string ir;
+
+            if (option == "-i" && options.cache->fetch(key, "program.ll", ir)){
+                output << ir;
+                return 0;
+            }
+
+            if (option != "-i" && options.cache->fetch(key, artifacts))
+                return 0;
+        }
     }
 
-    FILE* file;
-    if (argc == 3)
-        file = fopen(argv[2], "r");
-    else
-        file = fopen(argv[1], "r");
+    FILE* file = fopen(real_path.c_str(), "r");
 
     if (!file){
-        std::cerr << "vsopc: no such file or directory" << std::endl;
+        errors << "vsopc: no such file or directory" << std::endl;
         return 1;
     }
 
-    yyin = file;
-    if (argc == 3)
-        file_name = argv[2];
-    else
-        file_name = argv[1];
-    yyparse();
-    if (option == "-p" || option == "-c" || option == "-i" || option == ""){
-        vsop = new VSOPProgram(program);
-        vsop->file_name = file_name;
-        
-        if (option == "-p")
-            std::cout << vsop->print() << std::endl;
-        else {
-            SymbolTable scope;
-            vsop->declaration();
-            vsop->semanticAnalysis(*vsop, scope);
-            if (vsop->nb_errors != 0)
-                return vsop->nb_errors;
-            if (option == "-c"){
-                std::cout << vsop->print() << std::endl;
-                return 0;
-            }
-            
-            CodeGenerator coder("test");
-            vsop->pre_codegen(*vsop, coder);
-            vsop->codegen(*vsop, coder);
+    // The parser fills the program, and creates all the nodes inside its arena
+    std::unique_ptr<VSOPProgram> program(new VSOPProgram());
+    program->path = path;
 
-            if (option == "-i"){
-                std::cout << coder.print();
-                return 0;
-            }
+    ParseContext context;
+    context.file_name = path;
+    context.mode = (option == "-lex" || option == "-l") ? START_LEX : START_PARSE;
+    context.program = program.get();
+    context.output = &output;
+    context.errors = &errors;
+
+    bool parsed;
+    {
+        Span span("parse", "phase");
+        parsed = parse(file, context);
+    }
 
-            coder.optimizer();
+    fclose(file);
 
-            std::string basename = file_name.substr(0, file_name.find_last_of('.'));
-            
-            std::ofstream out(basename + ".ll");
-            out << coder.print();
-            out.close();
+    // Same exit code as when the parser used to exit on the first error
+    if (!parsed)
+        return -1;
 
-            std::string cmd = "llc-9 " + basename + ".ll -O2";
-            system(cmd.c_str());
+    if (options.ast_stats)
+        errors << "vsopc: " << program->arena.nb_objects << " nodes, " << program->arena.bytes_used
+               << " bytes used in the arena (" << program->arena.bytes_reserved << " reserved)" << std::endl;
 
-            cmd = "clang " + basename + ".s /vsop/object.s -lm -o " + basename;
-            system(cmd.c_str());
+    if (option == "-lex" || option == "-l")
+        return 0;
+
+    if (option == "-p"){
+        output << program->print() << std::endl;
+        return 0;
+    }
+
+    SymbolTable scope;
+    {
+        Span span("declaration", "phase");
+        program->declaration();
+    }
+    {
+        Span span("semantic", "phase");
+        program->semanticAnalysis(*program, scope);
+    }
+    if (program->nb_errors != 0)
+        return program->nb_errors;
+    if (option == "-c"){
+        output << program->print() << std::endl;
+        return 0;
+    }
+    {
+        Span span("fold", "phase");
+        program->fold();
+    }
+
+    CodeGenerator coder("test");
+    coder.bump_alloc = options.bump_alloc;
+    coder.gc = options.gc;
+    coder.inline_alloc = option != "-run";   // The JIT does not resolve the thread-local variables of vsopc
+    coder.whole_program = options.whole_program && option == "";   // Only an executable is known to be the whole program
+    {
+        Span span("pre_codegen", "phase");
+        program->pre_codegen(*program, coder);
+    }
+    {
+        Span span("codegen", "phase");
+        program->codegen(*program, coder);
+    }
 
+    if (option == "-i"){
+        // The IR is only optimized when a level is explicitly asked for
+        if (options.opt_level >= 0){
+            Span span("optimize", "phase");
+            coder.optimizer(options.opt_level);
         }
 
-        delete vsop;
+        std::string ir = coder.print();
+        output << ir;
 
+        if (!key.empty())
+            options.cache->store(key, "program.ll", ir);
+
+        return 0;
+    }
+
+    // The buffered runtime is inlined into the program when its bitcode is installed (the JIT has its own)
+    bool runtime_linked = false;
+
+    if (options.buffered_io && option != "-run" && llvm::sys::fs::exists("/vsop/object.bc")){
+        Span span("link runtime", "phase");
+
+        if (!coder.link_runtime("/vsop/object.bc")){
+            errors << "vsopc: cannot link the runtime /vsop/object.bc" << std::endl;
+            return 1;
+        }
+
+        runtime_linked = true;
     }
 
+    {
+        Span span("optimize", "phase");
+        coder.optimizer(options.opt_level >= 0 ? options.opt_level : 2);
+    }
+
+    if (option == "-run"){
+        // Execute the program in-process, nothing is written on disk
+        int exit_code;
+        Span span("run", "phase");
+
+        if (!coder.run(exit_code))
+            return 1;
+
+        return exit_code;
+    }
+
+    // The object file is emitted straight from the module, no textual IR in between
+    {
+        Span span("emit", "phase");
+
+        if (!coder.emit_object(basename + ".o")){
+            errors << "vsopc: cannot emit object file " << basename << ".o" << std::endl;
+            return 1;
+        }
+    }
+
+    if (option == "-emit-obj"){
+        if (!key.empty())
+            options.cache->store(key, artifacts);
+
+        return 0;
+    }
+
+    // Only the final link is left to an external tool
+    std::vector<std::string> linker = {"clang", basename[0] == '-' ? "./" + basename + ".o" : basename + ".o"};
+
+    if (!runtime_linked)
+        linker.push_back(options.buffered_io ? "/vsop/object.o" : "/vsop/object.s");
+
+    if (options.bump_alloc)
+        linker.push_back("/vsop/alloc.o");
+
+    if (options.gc)
+        linker.push_back("/vsop/gc.o");
+
+    linker.insert(linker.end(), {"-lm", "-o", basename});
+    Span span("link", "phase");
+
+    if (!run_tool(linker, errors)){
+        errors << "vsopc: cannot link " << basename << std::endl;
+        return 1;
+    }
+
+    if (!key.empty())
+        options.cache->store(key, artifacts);
+
     return 0;
 }
+
+/**
+ * Compiles the files of a command line, in parallel with -j N
+ *
+ * @param args The arguments of the command line, without the name of vsopc
+ * @param directory The directory of the relative paths, empty for the working directory
+ * @param output The stream where the results are written
+ * @param errors The stream where the diagnostics are written
+ *
+ * @returns The exit code of the command line
+ */
+static int run(const std::vector<std::string>& args, const std::string& directory, std::ostream& output, std::ostream& errors){
+
+    Options options;
+    std::string& option = options.option;
+    std::vector<std::string> paths;
+    unsigned jobs = 1;
+    bool cache_stats = false;
+    std::string cache_dir;
+    uint64_t cache_size = 512;  // In megabytes
+
+    options.directory = directory;
+
+    // A server takes the cache of the client from the arguments, not from its own environment
+    if (directory.empty() && getenv("VSOPC_CACHE_DIR") != nullptr)
+        cache_dir = getenv("VSOPC_CACHE_DIR");
+
+    if (directory.empty() && getenv("VSOPC_CACHE_SIZE") != nullptr)
+        cache_size = std::strtoull(getenv("VSOPC_CACHE_SIZE"), nullptr, 10);
+
+    for (size_t i = 0; i < args.size(); i++){
+        const std::string& arg = args[i];
+
+        if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3'){
+            options.opt_level = arg[2] - '0';
+
+        }else if (arg.compare(0, 2, "-j") == 0 && (arg.size() > 2 || i + 1 < args.size())){
+            // -j N or -jN, 0 for one job per core
+            jobs = std::strtoul(arg.size() > 2 ? arg.c_str() + 2 : args[++i].c_str(), nullptr, 10);
+
+            if (jobs == 0)
+                jobs = std::max(1u, std::thread::hardware_concurrency());
+
+        }else if (arg == "-cache-stats"){
+            cache_stats = true;
+
+        }else if (arg.compare(0, 11, "-cache-dir=") == 0 && arg.size() > 11){
+            cache_dir = arg.substr(11);
+
+        }else if (arg.compare(0, 12, "-cache-size=") == 0){
+            cache_size = std::strtoull(arg.c_str() + 12, nullptr, 10);
+
+        }else if (arg == "-ast-stats"){
+            options.ast_stats = true;
+
+        }else if (arg == "-alloc=bump" || arg == "-alloc=malloc"){
+            options.bump_alloc = arg == "-alloc=bump";
+
+        }else if (arg == "-gc"){
+            options.gc = true;
+
+        }else if (arg == "-buffered-io"){
+            options.buffered_io = true;
+
+        }else if (arg == "-no-whole-program"){
+            options.whole_program = false;
+
+        }else if (arg == "-time-report"){
+            profiler.time_report = true;
+
+        }else if (arg.compare(0, 7, "-trace=") == 0 && arg.size() > 7){
+            profiler.trace_file = arg.substr(7);
+
+        }else if (arg[0] == '-' && option == "" && paths.empty()){
+            option = arg;
+
+        }else{
+            paths.push_back(arg);
+        }
+    }
+
+    std::unique_ptr<Cache> cache;
+
+    if (!cache_dir.empty()){
+        // Like the paths of the files, a relative directory is the one of the client
+        if (cache_dir[0] != '/' && !directory.empty())
+            cache_dir = directory + "/" + cache_dir;
+
+        cache.reset(new Cache(cache_dir, cache_size << 20));
+        options.cache = cache.get();
+    }
+
+    if (cache_stats && cache == nullptr){
+        errors << "vsopc: -cache-stats needs VSOPC_CACHE_DIR or -cache-dir" << std::endl;
+        return 1;
+    }
+
+    if (paths.empty() && cache_stats){
+        cache->report(errors);
+        return 0;
+    }
+
+    if (paths.empty()){
+        errors << "vsopc: bad number of arguments" << std::endl;
+        return 1;
+    }
+
+    bool lex = option == "-lex" || option == "-l";
+
+    if (!lex && option != "-p" && option != "-c" && option != "-i" && option != "-emit-obj" && option != "-run" && option != ""){
+        errors << "vsopc: error in arguments" << std::endl;
+        return 1;
+    }
+
+    // The programs run on the standard streams of vsopc
+    if (paths.size() > 1 && option == "-run"){
+        errors << "vsopc: bad number of arguments" << std::endl;
+        return 1;
+    }
+
+    // The collector owns the objects, and the JIT cannot lower the shadow stack of vsopc
+    if (options.gc && (options.bump_alloc || option == "-run")){
+        errors << "vsopc: -gc cannot be used with -alloc=bump or -run" << std::endl;
+        return 1;
+    }
+
+    // The JIT always uses the runtime linked inside vsopc
+    if (options.buffered_io && option == "-run"){
+        errors << "vsopc: -buffered-io cannot be used with -run" << std::endl;
+        return 1;
+    }
+
+    if (paths.size() == 1){
+        int exit_code = compile(paths[0], options, output, errors);
+
+        if (cache_stats)
+            cache->report(errors);
+
+        return exit_code;
+    }
+
+    // Batch: each worker takes the next file, with its own context and code generator
+    std::vector<std::ostringstream> file_outputs(paths.size());
+    std::vector<std::ostringstream> file_errors(paths.size());
+    std::vector<int> exit_codes(paths.size(), 0);
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+
+    for (unsigned i = 0; i < jobs && i < paths.size(); i++)
+        workers.emplace_back([&](){
+            for (size_t k = next++; k < paths.size(); k = next++)
+                exit_codes[k] = compile(paths[k], options, file_outputs[k], file_errors[k]);
+        });
+
+    for (auto& worker : workers)
+        worker.join();
+
+    // The results are given in the order of the files, whatever the order the jobs ended in
+    int exit_code = 0;
+
+    for (size_t k = 0; k < paths.size(); k++){
+        output << file_outputs[k].str();
+        errors << file_errors[k].str();
+
+        if (exit_code == 0)
+            exit_code = exit_codes[k];
+    }
+
+    if (cache_stats)
+        cache->report(errors);
+
+    return exit_code;
+}
+
+int main(int argc, char const *argv[])
+{
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (args.size() == 2 && args[0] == "--serve"){
+        // The targets are registered and the runtime is read before the first request
+        CodeGenerator coder("vsopc");
+        CodeGenerator::load_runtime("/vsop/object.bc");
+
+        return server::serve(args[1], run);
+    }
+
+    std::string socket_path;
+    bool connect = args.size() >= 2 && args[0] == "--connect";
+
+    if (connect){
+        socket_path = args[1];
+        args.erase(args.begin(), args.begin() + 2);
+    }else if (getenv("VSOPC_SERVER") != nullptr){
+        socket_path = getenv("VSOPC_SERVER");
+    }
+
+    // The program of -run needs the terminal of the client, and the profiler measures the process it is in
+    bool local = false;
+
+    for (auto& arg : args)
+        local |= arg == "-run" || arg == "-time-report" || arg.compare(0, 7, "-trace=") == 0;
+
+    if (!socket_path.empty() && !local){
+        int exit_code;
+        std::vector<std::string> forwarded;
+
+        // The server does not see the environment of the client, its cache is given as arguments
+        if (getenv("VSOPC_CACHE_DIR") != nullptr){
+            llvm::SmallString<256> cache_dir(getenv("VSOPC_CACHE_DIR"));
+            llvm::sys::fs::make_absolute(cache_dir);
+            forwarded.push_back("-cache-dir=" + cache_dir.str().str());
+        }
+
+        if (getenv("VSOPC_CACHE_SIZE") != nullptr)
+            forwarded.push_back(std::string("-cache-size=") + getenv("VSOPC_CACHE_SIZE"));
+
+        forwarded.insert(forwarded.end(), args.begin(), args.end());
+
+        if (server::forward(socket_path, forwarded, exit_code))
+            return exit_code;
+
+        // Without --connect, the server is only used when it is up
+        if (connect){
+            std::cerr << "vsopc: cannot reach the server " << socket_path << std::endl;
+            return 1;
+        }
+    }
+
+    return run(args, "", std::cout, std::cerr);
+}
\ No newline at end of file
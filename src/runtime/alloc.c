@@ -0,0 +1,76 @@
+/*
+ * Allocator of the VSOP objects, used instead of malloc with -alloc=bump.
+ *
+ * Each thread owns a region of memory that objects are carved from by
+ * bumping a pointer. The compiler inlines this fast path inside the
+ * Class__new functions, reading vsop_alloc_cursor and vsop_alloc_limit
+ * directly, and only calls vsop_alloc_slow when the region is exhausted.
+ *
+ * Small objects are rounded up to a multiple of 16 bytes. The objects are
+ * never freed: the programs do not free them without the collector, and
+ * -gc has its own allocator. Large objects come from malloc.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define VSOP_GRANULE 16                                     /* Alignment and rounding of the sizes */
+#define VSOP_SMALL_MAX 256                                  /* Largest object served by the regions */
+#define VSOP_REGION_SIZE (1 << 20)
+
+/* Read and written by the code inlined in Class__new */
+__thread char* vsop_alloc_cursor = NULL;
+__thread char* vsop_alloc_limit = NULL;
+
+static size_t round_size(size_t size){
+    return (size + VSOP_GRANULE - 1) & ~(size_t) (VSOP_GRANULE - 1);
+}
+
+/* Takes a new region for the current thread, the rest of the old one is lost */
+static int refill(void){
+
+    char* region = malloc(VSOP_REGION_SIZE);
+
+    if (region == NULL)
+        return 0;
+
+    vsop_alloc_cursor = region;
+    vsop_alloc_limit = region + VSOP_REGION_SIZE;
+
+    return 1;
+}
+
+/*
+ * Slow path of the allocation, when the object does not fit in the
+ * current region. The size must already be rounded to the granule.
+ */
+void* vsop_alloc_slow(size_t size){
+
+    if (size == 0)
+        size = VSOP_GRANULE;
+
+    if (size > VSOP_SMALL_MAX)
+        return malloc(size);
+
+    if ((size_t) (vsop_alloc_limit - vsop_alloc_cursor) < size && !refill())
+        return NULL;
+
+    void* object = vsop_alloc_cursor;
+    vsop_alloc_cursor += size;
+
+    return object;
+}
+
+/* Whole allocation, for the callers that do not inline the fast path */
+void* vsop_alloc(size_t size){
+
+    size = round_size(size);
+
+    if (size != 0 && size <= VSOP_SMALL_MAX && (size_t) (vsop_alloc_limit - vsop_alloc_cursor) >= size){
+        void* object = vsop_alloc_cursor;
+        vsop_alloc_cursor += size;
+        return object;
+    }
+
+    return vsop_alloc_slow(size);
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*
+ * Precise mark-sweep garbage collector of the VSOP objects, used with -gc.
+ *
+ * The roots are found on the shadow stack that LLVM maintains for the
+ * functions marked with gc "shadow-stack": each frame links to the frame
+ * of its caller through llvm_gc_root_chain, up to main, and holds the
+ * slots declared with llvm.gcroot. The fields of an object that point to
+ * other objects are given by the pointer map of its class, which the
+ * compiler derives from the layout of the class structure.
+ *
+ * Every object is preceded by a header which links all the objects
+ * together for the sweep. Objects never move.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#define VSOP_GC_MIN_THRESHOLD (1 << 20)
+
+/* Layout defined by the shadow stack of LLVM (ShadowStackGCLowering) */
+typedef struct vsop_frame_map {
+    int32_t nb_roots;
+    int32_t nb_meta;
+    const void* meta[];
+} vsop_frame_map;
+
+typedef struct vsop_stack_entry {
+    struct vsop_stack_entry* next;
+    const vsop_frame_map* map;
+    void* roots[];
+} vsop_stack_entry;
+
+/* Offsets of the fields that point to objects, emitted by the compiler as gcmap.<Class> */
+typedef struct vsop_pointer_map {
+    int32_t nb_pointers;
+    int32_t offsets[];
+} vsop_pointer_map;
+
+typedef struct vsop_header {
+    struct vsop_header* next;
+    const vsop_pointer_map* map;
+    size_t size;
+    size_t mark;
+} vsop_header;
+
+/* Top of the shadow stack, updated by the prologue and the epilogue of the functions */
+vsop_stack_entry* llvm_gc_root_chain = NULL;
+
+static vsop_header* objects = NULL;
+static size_t bytes_allocated = 0;
+static size_t threshold = VSOP_GC_MIN_THRESHOLD;
+
+/* Objects that are marked but whose fields are not scanned yet */
+static vsop_header** gray = NULL;
+static size_t nb_gray = 0;
+static size_t gray_capacity = 0;
+
+static void mark(void* object){
+
+    if (object == NULL)
+        return;
+
+    vsop_header* header = (vsop_header*) object - 1;
+
+    if (header->mark)
+        return;
+
+    header->mark = 1;
+
+    if (nb_gray == gray_capacity){
+        gray_capacity = gray_capacity ? 2 * gray_capacity : 256;
+        gray = realloc(gray, gray_capacity * sizeof(vsop_header*));
+
+        if (gray == NULL){
+            fprintf(stderr, "vsop: out of memory during garbage collection\n");
+            abort();
+        }
+    }
+
+    gray[nb_gray++] = header;
+}
+
+void vsop_gc_collect(void){
+
+    /* Mark everything that is reachable from the frames of the shadow stack */
+    for (vsop_stack_entry* entry = llvm_gc_root_chain; entry != NULL; entry = entry->next)
+        for (int32_t i = 0; i < entry->map->nb_roots; i++)
+            mark(entry->roots[i]);
+
+    while (nb_gray > 0){
+
+        vsop_header* header = gray[--nb_gray];
+
+        if (header->map == NULL)
+            continue;
+
+        char* object = (char*) (header + 1);
+
+        for (int32_t i = 0; i < header->map->nb_pointers; i++)
+            mark(*(void**) (object + header->map->offsets[i]));
+    }
+
+    /* Sweep the objects that have not been marked */
+    size_t live = 0;
+    vsop_header** link = &objects;
+
+    while (*link != NULL){
+
+        vsop_header* header = *link;
+
+        if (header->mark){
+            header->mark = 0;
+            live += header->size;
+            link = &header->next;
+        }else{
+            *link = header->next;
+            free(header);
+        }
+    }
+
+    bytes_allocated = live;
+    threshold = 2 * live > VSOP_GC_MIN_THRESHOLD ? 2 * live : VSOP_GC_MIN_THRESHOLD;
+}
+
+/* Allocates a zeroed object, which is reclaimed once it is not reachable anymore */
+void* vsop_gc_alloc(size_t size, const vsop_pointer_map* map){
+
+    if (bytes_allocated + size > threshold)
+        vsop_gc_collect();
+
+    vsop_header* header = calloc(1, sizeof(vsop_header) + size);
+
+    if (header == NULL)
+        return NULL;
+
+    header->next = objects;
+    header->map = map;
+    header->size = size;
+    objects = header;
+
+    bytes_allocated += size;
+
+    return header + 1;
+}
\ No newline at end of file
@@ -0,0 +1,283 @@
+/*
+ * Buffered implementation of the Object class, used with -buffered-io
+ * instead of object.s. It defines the same symbols and the same vtable,
+ * so the generated code links with either of them.
+ *
+ * The output is kept in a large buffer which is written with a single
+ * system call when it is full, when the program reads its input, and
+ * at exit. The integers are formatted by hand. The input is read by
+ * blocks and scanned inside the buffer, without going through stdio.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define VSOP_OUTPUT_SIZE (1 << 16)
+#define VSOP_INPUT_SIZE (1 << 16)
+
+typedef struct Object Object;
+
+struct Object {
+    const void* const* vtable;
+};
+
+static char output[VSOP_OUTPUT_SIZE];
+static size_t output_length = 0;
+
+static char input[VSOP_INPUT_SIZE];
+static size_t input_start = 0;
+static size_t input_end = 0;
+
+static void write_all(const char* data, size_t length){
+
+    while (length > 0){
+
+        ssize_t written = write(STDOUT_FILENO, data, length);
+
+        if (written <= 0)
+            return;
+
+        data += written;
+        length -= written;
+    }
+}
+
+static void flush_output(void){
+
+    write_all(output, output_length);
+    output_length = 0;
+}
+
+/* The output is flushed once main returns or exit is called */
+__attribute__((destructor)) static void flush_at_exit(void){
+    flush_output();
+}
+
+static void append(const char* data, size_t length){
+
+    if (output_length + length > VSOP_OUTPUT_SIZE){
+
+        flush_output();
+
+        /* Too large to be buffered at all */
+        if (length > VSOP_OUTPUT_SIZE){
+            write_all(data, length);
+            return;
+        }
+    }
+
+    memcpy(output + output_length, data, length);
+    output_length += length;
+}
+
+/* Reads the next block of the input, returns 0 at the end of the input */
+static int fill_input(void){
+
+    ssize_t nb_read;
+
+    /* The user must see the prompt before typing the answer */
+    flush_output();
+
+    do
+        nb_read = read(STDIN_FILENO, input, VSOP_INPUT_SIZE);
+    while (nb_read < 0 && errno == EINTR);
+
+    input_start = 0;
+    input_end = nb_read > 0 ? nb_read : 0;
+
+    return input_end > 0;
+}
+
+static void skip_space(void){
+
+    for (;;){
+
+        while (input_start < input_end && isspace((unsigned char) input[input_start]))
+            input_start++;
+
+        if (input_start < input_end || !fill_input())
+            return;
+    }
+}
+
+/*
+ * Reads the input up to the end of the line, or up to the next space,
+ * which is left in the input. Returns a new string, NULL if out of memory.
+ */
+static char* read_until(int eol){
+
+    size_t size = 1024, length = 0;
+    char* text = malloc(size);
+
+    if (text == NULL)
+        return NULL;
+
+    for (;;){
+
+        if (input_start == input_end && !fill_input())
+            break;
+
+        size_t end = input_start;
+
+        if (eol){
+            const char* found = memchr(input + input_start, '\n', input_end - input_start);
+            end = found ? (size_t) (found - input) : input_end;
+        }else{
+            while (end < input_end && !isspace((unsigned char) input[end]))
+                end++;
+        }
+
+        size_t chunk = end - input_start;
+
+        if (length + chunk + 1 > size){
+
+            while (length + chunk + 1 > size)
+                size *= 2;
+
+            char* bigger = realloc(text, size);
+
+            if (bigger == NULL){
+                free(text);
+                return NULL;
+            }
+
+            text = bigger;
+        }
+
+        memcpy(text + length, input + input_start, chunk);
+        length += chunk;
+        input_start = end;
+
+        if (end < input_end)
+            break;
+    }
+
+    text[length] = '\0';
+
+    return text;
+}
+
+static void input_error(const char* format, const char* word){
+
+    flush_output();
+    fprintf(stderr, format, word);
+    exit(1);
+}
+
+Object* Object_print(Object* self, const char* text){
+
+    append(text, strlen(text));
+    return self;
+}
+
+Object* Object_printBool(Object* self, int value){
+
+    /* Only the lowest bit of an i1 argument is defined */
+    if (value & 1)
+        append("true", 4);
+    else
+        append("false", 5);
+
+    return self;
+}
+
+Object* Object_printInt32(Object* self, int32_t value){
+
+    char digits[12];
+    char* start = digits + sizeof(digits);
+    uint32_t magnitude = value < 0 ? - (uint32_t) value : (uint32_t) value;
+
+    do{
+        *--start = '0' + magnitude % 10;
+        magnitude /= 10;
+    }while (magnitude != 0);
+
+    if (value < 0)
+        *--start = '-';
+
+    append(start, digits + sizeof(digits) - start);
+    return self;
+}
+
+const char* Object_inputLine(Object* self){
+
+    char* line = read_until(1);
+
+    if (line == NULL)
+        return "";
+
+    return line;
+}
+
+_Bool Object_inputBool(Object* self){
+
+    skip_space();
+    char* word = read_until(0);
+
+    if (word == NULL)
+        input_error("Object::inputBool: cannot read word!\n", "");
+
+    _Bool value = 0;
+
+    if (strcmp(word, "true") == 0)
+        value = 1;
+    else if (strcmp(word, "false") != 0)
+        input_error("Object::inputBool: `%s` is not a valid boolean!\n", word);
+
+    free(word);
+    return value;
+}
+
+int32_t Object_inputInt32(Object* self){
+
+    skip_space();
+    char* word = read_until(0);
+
+    if (word == NULL)
+        input_error("Object::inputInt32: cannot read word!\n", "");
+
+    size_t length = strlen(word);
+    int hexadecimal = (length >= 3 && word[0] == '0' && word[1] == 'x')
+                   || (length >= 4 && (word[0] == '+' || word[0] == '-') && word[1] == '0' && word[2] == 'x');
+
+    char* end;
+    long long value = strtoll(word, &end, hexadecimal ? 16 : 10);
+
+    if (*end != '\0')
+        input_error("Object::inputInt32: `%s` is not a valid integer literal!\n", word);
+
+    if (value < INT32_MIN || value > INT32_MAX)
+        input_error("Object::inputInt32: `%s` does not fit a 32-bit integer!\n", word);
+
+    free(word);
+    return (int32_t) value;
+}
+
+Object* Object__init(Object* self);
+
+Object* Object__new(void){
+    return Object__init(malloc(sizeof(Object)));
+}
+
+/* Same order as in object.s, which is the order the compiler expects */
+const void* const object_vtable[] __asm__("vtable.Object") = {
+    Object_print,
+    Object_printBool,
+    Object_printInt32,
+    Object_inputLine,
+    Object_inputBool,
+    Object_inputInt32
+};
+
+Object* Object__init(Object* self){
+
+    if (self != NULL)
+        self->vtable = object_vtable;
+
+    return self;
+}
\ No newline at end of file
@@ -1,19 +1,24 @@
 %code requires{
     #include<iostream>
     #include<string.h>
+    #include <deque>
     #include <memory>
+    #include <stack>
     #include "ast/ast.hpp"
     #include "ast/utils.hpp"
 
     struct Helper{
     VSOPList<Field> field;
     VSOPList<Method> method;
+
+    explicit Helper(Arena* arena): field(arena), method(arena) {}
     };
 }
 
 %union{
     int val;
-    char* sval;
+    Symbol sym;
+    const std::string* str;
     Expr* expr;
     Formal* formal;
     Method* method;
@@ -36,17 +41,51 @@
     } yyltype;
     
 }
+
+%code requires{
+    typedef void* yyscan_t;
+
+    /**
+     * State of the parsing of one file, shared by the lexer and the parser.
+     * Nothing is global, so several files can be parsed at the same time.
+     */
+    struct ParseContext{
+        std::string file_name;
+        int mode = 0;                   // First token given to the parser, START_LEX or START_PARSE
+        VSOPProgram* program = nullptr; // Receives the classes, and owns the nodes
+        std::ostream* output = &std::cout;  // Where the tokens are printed
+        std::ostream* errors = &std::cerr;  // Where the lexical and syntax errors are printed
+        int nb_errors = 0;
+
+        std::stack<yyltype> stack;      // Positions of the opening comments and of the opening quote
+        std::string buffer;             // Text of the string-literal being read
+        std::deque<std::string> literals;   // Texts of the string-literals read, not interned so that a server does not keep them
+    };
+}
+
+%code provides{
+    /**
+     * Parses a file into the program of the context
+     *
+     * @param file The opened VSOP file
+     * @param context The context of the parsing, which holds the program
+     *
+     * @returns true if there is no lexical nor syntax error, false else
+     */
+    bool parse(FILE* file, ParseContext& context);
+
+    void yyerror(YYLTYPE* loc, yyscan_t scanner, ParseContext& context, const std::string& text);
+}
 %locations
+%define api.pure full
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {ParseContext& context}
 
 %{
-    void yyerror(const std::string& text);
-    void printResult(const std::string& text);
-    int yylex(void);
-    int yyparse(void);
-    extern std::string file_name;
-    extern VSOPList<Class> program;
+    void printResult(ParseContext& context, const YYLTYPE& loc, const std::string& text);
+    int yylex(YYSTYPE* lvalp, YYLTYPE* llocp, yyscan_t scanner);
     void setPosition(Node* node, const YYLTYPE& pos);
-    void setFileName(Node* node, std::string& file_name);
+    void setFileName(Node* node, const std::string& file_name);
 
 %}
 %define parse.error verbose
@@ -54,57 +93,57 @@
 %token END
 
 %token <val> INT_LITERAL
-%token <sval> STR_LITERAL
-%token <sval> OBJECT_IDENTIFIER
-%token <sval>TYPE_IDENTIFIER
-
-%token <sval> AND
-%token <sval> BOOL
-%token <sval> CLASS
-%token <sval> DO
-%token <sval> ELSE
-%token <sval> EXTENDS
-%token <sval> FALSE
-%token <sval> IF
-%token <sval> IN
-%token <sval> INT32
-%token <sval> ISNULL
-%token <sval> LET
-%token <sval> NEW
-%token <sval> NOT
-%token <sval> SELF
-%token <sval> STRING
-%token <sval> THEN
-%token <sval> TRUE
-%token <sval> UNIT
-%token <sval> WHILE
-
-%token <sval> LBRACE
-%token <sval> RBRACE
-%token <sval> LPAR
-%token <sval> RPAR
-%token <sval> COLON
-%token <sval> SEMICOLON
-%token <sval> COMMA
-%token <sval> PLUS
-%token <sval> MINUS
-%token <sval> TIMES
-%token <sval> DIV
-%token <sval> POW
-%token <sval> DOT
-%token <sval> EQUAL
-%token <sval> LOWER
-%token <sval> LOWER_EQUAL
-%token <sval> ASSIGN
+%token <str> STR_LITERAL
+%token <sym> OBJECT_IDENTIFIER
+%token <sym> TYPE_IDENTIFIER
+
+%token <sym> AND
+%token <sym> BOOL
+%token <sym> CLASS
+%token <sym> DO
+%token <sym> ELSE
+%token <sym> EXTENDS
+%token <sym> FALSE
+%token <sym> IF
+%token <sym> IN
+%token <sym> INT32
+%token <sym> ISNULL
+%token <sym> LET
+%token <sym> NEW
+%token <sym> NOT
+%token <sym> SELF
+%token <sym> STRING
+%token <sym> THEN
+%token <sym> TRUE
+%token <sym> UNIT
+%token <sym> WHILE
+
+%token LBRACE
+%token RBRACE
+%token LPAR
+%token RPAR
+%token COLON
+%token SEMICOLON
+%token COMMA
+%token PLUS
+%token MINUS
+%token TIMES
+%token DIV
+%token POW
+%token DOT
+%token EQUAL
+%token LOWER
+%token LOWER_EQUAL
+%token ASSIGN
 
 %token START_LEX START_PARSE;
 
 %start start;
 
-%nterm <sval> type
-%nterm <sval> extends
-%nterm <sval> type-id
-%nterm <sval> object-id
+%nterm <sym> type
+%nterm <sym> extends
+%nterm <sym> type-id
+%nterm <sym> object-id
 %nterm <_class> class
 %nterm <help> class-body
 %nterm <field> field
@@ -127,6 +166,7 @@
 %nterm <expr> literal
 %nterm <expr> init
 
+
 %precedence IF THEN WHILE DO LET IN
 %precedence ELSE
 
@@ -149,153 +189,153 @@ start:           START_LEX token
 
 token:          
                 |token INT_LITERAL
-                    {std::string text ="integer-literal," + std::to_string(yylval.val); printResult(text);}
+                    {std::string text ="integer-literal," + std::to_string(yylval.val); printResult(context, yylloc, text);}
                 |token STR_LITERAL
-                    {std::string text ="string-literal," ; printResult(text + String($2).print());}
+                    {std::string text ="string-literal," ; printResult(context, yylloc, text + String(*$2).print());}
                 |token OBJECT_IDENTIFIER
-                    {std::string text ="object-identifier," ; printResult(text + yylval.sval);}
+                    {std::string text ="object-identifier," ; printResult(context, yylloc, text + yylval.sym.str());}
                 |token TYPE_IDENTIFIER
-                    {std::string text ="type-identifier," ; printResult(text + yylval.sval);}
+                    {std::string text ="type-identifier," ; printResult(context, yylloc, text + yylval.sym.str());}
                 |token AND
-                    {printResult("and");}
+                    {printResult(context, yylloc, "and");}
                 |token BOOL
-                    {printResult("bool");}
+                    {printResult(context, yylloc, "bool");}
                 |token CLASS
-                    {printResult("class");}
+                    {printResult(context, yylloc, "class");}
                 |token DO
-                    {printResult("do");}
+                    {printResult(context, yylloc, "do");}
                 |token ELSE
-                    {printResult("else");}
+                    {printResult(context, yylloc, "else");}
                 |token EXTENDS
-                    {printResult("extends");}
+                    {printResult(context, yylloc, "extends");}
                 |token FALSE
-                    {printResult("false");}
+                    {printResult(context, yylloc, "false");}
                 |token IF
-                    {printResult("if");}
+                    {printResult(context, yylloc, "if");}
                 |token IN
-                    {printResult("in");}
+                    {printResult(context, yylloc, "in");}
                 |token INT32
-                    {printResult("int32");}
+                    {printResult(context, yylloc, "int32");}
                 |token ISNULL
-                    {printResult("isnull");}
+                    {printResult(context, yylloc, "isnull");}
                 |token LET
-                    {printResult("let");}
+                    {printResult(context, yylloc, "let");}
                 |token NEW
-                    {printResult("new");}
+                    {printResult(context, yylloc, "new");}
                 |token NOT
-                    {printResult("not");}
+                    {printResult(context, yylloc, "not");}
                 |token SELF
-                    {printResult("self");}
+                    {printResult(context, yylloc, "self");}
                 |token STRING
-                    {printResult("string");}
+                    {printResult(context, yylloc, "string");}
                 |token THEN
-                    {printResult("then");}
+                    {printResult(context, yylloc, "then");}
                 |token TRUE
-                    {printResult("true");}
+                    {printResult(context, yylloc, "true");}
                 |token UNIT
-                    {printResult("unit");}
+                    {printResult(context, yylloc, "unit");}
                 |token WHILE
-                    {printResult("while");}
+                    {printResult(context, yylloc, "while");}
                 |token LBRACE
-                    {printResult("lbrace");}
+                    {printResult(context, yylloc, "lbrace");}
                 |token RBRACE
-                    {printResult("rbrace");}
+                    {printResult(context, yylloc, "rbrace");}
                 |token LPAR
-                    {printResult("lpar");}
+                    {printResult(context, yylloc, "lpar");}
                 |token RPAR
-                    {printResult("rpar");}
+                    {printResult(context, yylloc, "rpar");}
                 |token COLON
-                    {printResult("colon");}
+                    {printResult(context, yylloc, "colon");}
                 |token SEMICOLON
-                    {printResult("semicolon");}
+                    {printResult(context, yylloc, "semicolon");}
                 |token COMMA
-                    {printResult("comma");}
+                    {printResult(context, yylloc, "comma");}
                 |token PLUS
-                    {printResult("plus");}
+                    {printResult(context, yylloc, "plus");}
                 |token MINUS
-                    {printResult("minus");}
+                    {printResult(context, yylloc, "minus");}
                 |token TIMES
-                    {printResult("times");}
+                    {printResult(context, yylloc, "times");}
                 |token DIV
-                    {printResult("div");}
+                    {printResult(context, yylloc, "div");}
                 |token POW
-                    {printResult("pow");}
+                    {printResult(context, yylloc, "pow");}
                 |token DOT
-                    {printResult("dot");}
+                    {printResult(context, yylloc, "dot");}
                 |token EQUAL
-                    {printResult("equal");}
+                    {printResult(context, yylloc, "equal");}
                 |token LOWER
-                    {printResult("lower");}
+                    {printResult(context, yylloc, "lower");}
                 |token LOWER_EQUAL
-                    {printResult("lower-equal");}
+                    {printResult(context, yylloc, "lower-equal");}
                 |token ASSIGN
-                    {printResult("assign");}
+                    {printResult(context, yylloc, "assign");}
 
 program :   program-rec
                 | program-rec program
 
 program-rec:    class
-                {program.push($1);};
+                {context.program->program.push($1);};
 
 class: CLASS type-id extends LBRACE class-body
-                {$$ = new Class($2, $3, $5->field.reverse(), $5->method.reverse());
+                {$$ = context.program->arena.make<Class>($2, $3, $5->field.reverse(), $5->method.reverse());
                     setPosition($$, @$);
-                    setFileName($$, file_name);};
+                    setFileName($$, context.program->path);};
 
 extends:        /* EPSILON */
-                {$$ = strdup("Object");}
+                {$$ = symbols::OBJECT;}
                 | EXTENDS type-id
                 {$$ = $2;};
 
 class-body:        RBRACE 
-                    {$$ = new Helper();}
+                    {$$ = context.program->arena.make<Helper>(&context.program->arena);}
                     | field SEMICOLON class-body
                     {$3->field.push($1); $$ = $3;}
                     | method class-body
                     {$2->method.push($1); $$ = $2;}
                     | error END
-                    {yyerror("syntax error: missing closing bracket"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: missing closing bracket"); YYABORT;};
 
 field:              object-id COLON type init
-                    {$$ = new Field($1, $3, $4);
+                    {$$ = context.program->arena.make<Field>($1, $3, $4);
                         setPosition($$, @$);
-                        setFileName($$, file_name);};
+                        setFileName($$, context.program->path);};
 
 method:             method-aux block
-                    {$1->block = std::make_shared<Block>($2->reverse()); $$ = $1; delete $2;
+                    {$1->block = context.program->arena.make<Block>($2->reverse()); $$ = $1;
                         setPosition($$, @$);
-                        setFileName($$, file_name);};
+                        setFileName($$, context.program->path);};
 
 method-aux:         object-id formals COLON type
-                    {$$ = new Method($1, $4, $2->reverse(), NULL); delete $2;
-                        setFileName($$, file_name);};
+                    {$$ = context.program->arena.make<Method>($1, $4, $2->reverse(), nullptr);
+                        setFileName($$, context.program->path);};
 
 formal:             object-id COLON type
-                    {$$ = new Formal($1, $3);
+                    {$$ = context.program->arena.make<Formal>($1, $3);
                         setPosition($$, @$);
-                        setFileName($$, file_name);};
+                        setFileName($$, context.program->path);};
 
 formals:            LPAR RPAR
-                    {$$ = new VSOPList<Formal>();}
+                    {$$ = context.program->arena.make<VSOPList<Formal>>(&context.program->arena);}
                     | LPAR formals-rec
                     {$$ = $2;};
 
 formals-rec:        formal RPAR
-                    {$$ = new VSOPList<Formal>(); $$->push($1);}
+                    {$$ = context.program->arena.make<VSOPList<Formal>>(&context.program->arena); $$->push($1);}
                     | formal COMMA formals-rec
                     {$3->push($1); $$ = $3;}
                     | error RPAR
-                    {yyerror("syntax error: invalid formal"); }
+                    {yyerror(&yylloc, scanner, context, "syntax error: invalid formal"); YYABORT;}
                     | error COLON formals-rec
-                    {yyerror("syntax error: invalid formal"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: invalid formal"); YYABORT;};
 
 object-id:          OBJECT_IDENTIFIER
                     | TYPE_IDENTIFIER
-                    {yyerror("syntax error: expected object-identifier but received a type-identifier"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: expected object-identifier but received a type-identifier"); YYABORT;};
 
 type-id:            TYPE_IDENTIFIER
                     | OBJECT_IDENTIFIER
-                    {yyerror("syntax error: expected type-identifier but received an object-identifier"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: expected type-identifier but received an object-identifier"); YYABORT;};
 
 type:               type-id
                     | INT32
@@ -306,21 +346,21 @@ type:               type-id
 block:              LBRACE block-rec
                     {$$ = $2;}
                     | LBRACE RBRACE
-                    {yyerror("syntax error: block without a body"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: block without a body"); YYABORT;};
 
 block-rec:          expr RBRACE
-                    {$$ = new VSOPList<Expr>(); $$->push($1);}
+                    {$$ = context.program->arena.make<VSOPList<Expr>>(&context.program->arena); $$->push($1);}
                     | expr SEMICOLON block-rec
                     {$3->push($1); $$ = $3;}
                     | error block block-rec
-                    {yyerror("syntax error: unmatched {"); }
+                    {yyerror(&yylloc, scanner, context, "syntax error: unmatched {"); YYABORT;}
                     | error END
-                    {yyerror("syntax error: unclosed brackets {}"); };
+                    {yyerror(&yylloc, scanner, context, "syntax error: unclosed brackets {}"); YYABORT;};
 
 expr:               expr-rec
                     {$$ = $1;
                         setPosition($$, @$);
-                        setFileName($$, file_name);};
+                        setFileName($$, context.program->path);};
 
 expr-rec:           if
                     | while
@@ -330,30 +370,30 @@ expr-rec:           if
                     | call
                     | literal
                     | NEW type-id
-                    { $$ = new New($2);}
+                    { $$ = context.program->arena.make<New>($2);}
                     | object-id ASSIGN expr
-                    { $$ = new Assign($1, $3);}
+                    { $$ = context.program->arena.make<Assign>($1, $3);}
                     | object-id
-                    { $$ = new Identifier($1);}
+                    { $$ = context.program->arena.make<Identifier>($1);}
                     | LPAR RPAR
-                    {$$ = new Unit();}
+                    {$$ = context.program->arena.make<Unit>();}
                     | LPAR expr RPAR
                     {$$ = $2;}
                     | block
-                    {$$ = new Block($1->reverse()); delete $1;}
+                    {$$ = context.program->arena.make<Block>($1->reverse());}
                     | SELF
-                    {$$ = new Self();};
+                    {$$ = context.program->arena.make<Self>();};
 
 if:                 IF expr THEN expr
-                    {$$ = new If($2, $4, NULL);}
+                    {$$ = context.program->arena.make<If>($2, $4, nullptr);}
                     | IF expr THEN expr ELSE expr
-                    {$$ = new If($2, $4, $6);};
+                    {$$ = context.program->arena.make<If>($2, $4, $6);};
 
 while:              WHILE expr DO expr
-                    {$$ = new While($2, $4);};
+                    {$$ = context.program->arena.make<While>($2, $4);};
 
 let:                LET object-id COLON type init IN expr
-                    {$$ = new Let($2, $4, $5, $7);};
+                    {$$ = context.program->arena.make<Let>($2, $4, $5, $7);};
 
 init:               /* EPSILON */
                     {$$ = NULL;}
@@ -361,56 +401,56 @@ init:               /* EPSILON */
                     {$$ = $2;};
 
 binary:             expr EQUAL expr
-                    {$$ = new BinOp(BinOp::EQUAL, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::EQUAL, $1, $3);}
                     | expr LOWER expr
-                    {$$ = new BinOp(BinOp::LOWER, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::LOWER, $1, $3);}
                     | expr LOWER_EQUAL expr
-                    {$$ = new BinOp(BinOp::LOWER_EQ, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::LOWER_EQ, $1, $3);}
                     | expr PLUS expr
-                    {$$ = new BinOp(BinOp::PLUS, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::PLUS, $1, $3);}
                     | expr MINUS expr
-                    {$$ = new BinOp(BinOp::MINUS, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::MINUS, $1, $3);}
                     | expr TIMES expr
-                    {$$ = new BinOp(BinOp::TIMES, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::TIMES, $1, $3);}
                     | expr DIV expr
-                    {$$ = new BinOp(BinOp::DIV, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::DIV, $1, $3);}
                     | expr POW expr
-                    {$$ = new BinOp(BinOp::POW, $1, $3);}
+                    {$$ = context.program->arena.make<BinOp>(BinOp::POW, $1, $3);}
                     | expr AND expr
-                    {$$ = new BinOp(BinOp::AND, $1, $3);};
+                    {$$ = context.program->arena.make<BinOp>(BinOp::AND, $1, $3);};
 
 unary:              NOT expr
-                    {$$ = new UnOp(UnOp::NOT, $2);}
+                    {$$ = context.program->arena.make<UnOp>(UnOp::NOT, $2);}
                     | ISNULL expr
-                    {$$ = new UnOp(UnOp::ISNULL, $2);}
+                    {$$ = context.program->arena.make<UnOp>(UnOp::ISNULL, $2);}
                     | MINUS expr %prec UNARY_MINUS
-                    {$$ = new UnOp(UnOp::MINUS, $2);};
+                    {$$ = context.program->arena.make<UnOp>(UnOp::MINUS, $2);};
 
 literal:            INT_LITERAL
-                    {$$ = new Integer($1);}
+                    {$$ = context.program->arena.make<Integer>($1);}
                     | STR_LITERAL
-                    {$$ = new String($1);}
+                    {$$ = context.program->arena.make<String>(llvm::StringRef(context.program->arena.copy(*$1), $1->size()));}
                     | TRUE
-                    {$$ = new Boolean(true);}
+                    {$$ = context.program->arena.make<Boolean>(true);}
                     | FALSE
-                    {$$ = new Boolean(false);};
+                    {$$ = context.program->arena.make<Boolean>(false);};
 
 call:               expr DOT object-id args
-                    {$$ = new Call($1, $3, $4->reverse()); delete $4;}
+                    {$$ = context.program->arena.make<Call>($1, $3, $4->reverse());}
                     | object-id args
-                    {$$ = new Call(new Self(), $1, $2->reverse()); delete $2;};
+                    {$$ = context.program->arena.make<Call>(context.program->arena.make<Self>(), $1, $2->reverse());};
 
 args:               LPAR RPAR
-                    {$$ = new VSOPList<Expr>();}
+                    {$$ = context.program->arena.make<VSOPList<Expr>>(&context.program->arena);}
                     | LPAR args-rec
                     {$$ = $2;};
 
 args-rec:           expr RPAR
-                    {$$ = new VSOPList<Expr>(); $$->push($1);}
+                    {$$ = context.program->arena.make<VSOPList<Expr>>(&context.program->arena); $$->push($1);}
                     | expr COMMA args-rec
                     {$3->push($1); $$ = $3;}
                     | error END
-                    {yyerror("syntax error: unmatched ( in arguments");  };
+                    {yyerror(&yylloc, scanner, context, "syntax error: unmatched ( in arguments"); YYABORT;};
 
 
 
@@ -418,15 +458,19 @@ args-rec:           expr RPAR
 
 %%
 
-void yyerror(const std::string& text){
-        std::cerr << file_name << ":" << yylloc.first_line << ":";
-        std::cerr << yylloc.first_column << ": " << text << std::endl;
-        exit(-1);
-    }
+void yyerror(YYLTYPE* loc, yyscan_t scanner, ParseContext& context, const std::string& text){
+
+    // Only the first error is reported, the parsing stops there
+    if (context.nb_errors++ != 0)
+        return;
+
+    *context.errors << context.file_name << ":" << loc->first_line << ":";
+    *context.errors << loc->first_column << ": " << text << std::endl;
+}
 
 
-void printResult(const std::string& text){
-    std::cout << yylloc.first_line << "," << yylloc.first_column << "," << text << std::endl;
+void printResult(ParseContext& context, const YYLTYPE& loc, const std::string& text){
+    *context.output << loc.first_line << "," << loc.first_column << "," << text << std::endl;
 }
 
 void setPosition(Node* node, const YYLTYPE& pos){
@@ -435,6 +479,6 @@ void setPosition(Node* node, const YYLTYPE& pos){
 
 }
 
-void setFileName(Node* node, std::string& file_name){
-    node->file_name = file_name;
+void setFileName(Node* node, const std::string& file_name){
+    node->file_name = &file_name;
 }
\ No newline at end of file
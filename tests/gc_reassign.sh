@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Regression test of the roots of the temporaries with -gc: an object
+# loaded from a variable or a field must survive the allocations made
+# before it is used, even if the variable or the field is assigned in
+# between and the object is then only held by the temporary.
+#
+# Usage: tests/gc_reassign.sh [path to vsopc]
+#
+# Each iteration passes the old object of a field and of a local
+# variable to a call whose next arguments assign them and allocate.
+# A collection that frees the old object lets the allocator reuse its
+# memory for the new ones, so the old object reads a wrong id or crashes.
+
+VSOPC=${1:-$(dirname "$0")/../src/vsopc}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ ! -x "$VSOPC" ]; then
+    echo "gc_reassign: vsopc not found at $VSOPC" >&2
+    exit 1
+fi
+
+cat > "$WORK/reassign.vsop" <<EOF
+class A {
+    id : int32;
+
+    init(n : int32) : A {
+        id <- n;
+        self
+    }
+
+    get() : int32 { id }
+}
+
+class Main {
+    field : A;
+
+    check(old : A, fresh : A, filler : A, expected : int32) : int32 {
+        if old.get() = expected then 0 else 1
+    }
+
+    main() : int32 {
+        let errors : int32 <- 0 in
+        let local : A <- (new A).init(0) in
+        let i : int32 <- 0 in {
+            field <- (new A).init(0);
+
+            while i < 200000 do {
+                errors <- errors + check(field, field <- (new A).init(i + 1), (new A).init(-1), i);
+                errors <- errors + check(local, local <- (new A).init(i + 1), (new A).init(-1), i);
+                i <- i + 1
+            };
+
+            if errors = 0 then print("ok\n") else print("objects used after being freed\n");
+            errors
+        }
+    }
+}
+EOF
+
+"$VSOPC" -gc "$WORK/reassign.vsop" || exit 1
+
+result=$("$WORK/reassign")
+status=$?
+
+echo "$result"
+
+if [ $status -ne 0 ] || [ "$result" != "ok" ]; then
+    echo "gc_reassign: a temporary loaded from a reassigned variable has been collected" >&2
+    exit 1
+fi